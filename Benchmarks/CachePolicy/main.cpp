@@ -0,0 +1,312 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <random>
+#include "FrequencySketch.h"
+
+// Replays access traces against the eviction policy StaticFileCache used to have, plain LRU, and the W-TinyLFU
+// admission it uses now, and prints the hit ratio of each at several capacities. Items all have the same size, the
+// capacity is a number of files. Both policies keep exact recency here, the cache itself only approximates it.
+
+typedef QVector<quint32> Trace;
+
+class LruPolicy
+{
+    int m_capacity;
+    std::list<quint32> m_order;
+    QHash<quint32, std::list<quint32>::iterator> m_items;
+
+public:
+    LruPolicy(int capacity)
+        :m_capacity(capacity),
+          m_order(),
+          m_items()
+    {}
+
+    bool access(quint32 key)
+    {
+        QHash<quint32, std::list<quint32>::iterator>::iterator iter = m_items.find(key);
+
+        if (iter != m_items.end())
+        {
+            m_order.splice(m_order.begin(), m_order, iter.value());
+            return true;
+        }
+
+        m_order.push_front(key);
+        m_items.insert(key, m_order.begin());
+
+        if (m_items.size() > m_capacity)
+        {
+            m_items.remove(m_order.back());
+            m_order.pop_back();
+        }
+
+        return false;
+    }
+};
+
+class WindowTinyLfuPolicy
+{
+    int m_windowCapacity;
+    int m_mainCapacity;
+    std::list<quint32> m_windowOrder;
+    std::list<quint32> m_mainOrder;
+    QHash<quint32, std::list<quint32>::iterator> m_windowItems;
+    QHash<quint32, std::list<quint32>::iterator> m_mainItems;
+    FrequencySketch m_sketch;
+
+public:
+    WindowTinyLfuPolicy(int capacity)
+        :m_windowCapacity(qMax(capacity / 100, 1)),
+          m_mainCapacity(qMax(capacity - qMax(capacity / 100, 1), 1)),
+          m_windowOrder(),
+          m_mainOrder(),
+          m_windowItems(),
+          m_mainItems(),
+          m_sketch(capacity * 4)
+    {}
+
+    bool access(quint32 key)
+    {
+        m_sketch.increment(qHash(key));
+
+        QHash<quint32, std::list<quint32>::iterator>::iterator iter = m_windowItems.find(key);
+
+        if (iter != m_windowItems.end())
+        {
+            m_windowOrder.splice(m_windowOrder.begin(), m_windowOrder, iter.value());
+            return true;
+        }
+
+        iter = m_mainItems.find(key);
+
+        if (iter != m_mainItems.end())
+        {
+            m_mainOrder.splice(m_mainOrder.begin(), m_mainOrder, iter.value());
+            return true;
+        }
+
+        m_windowOrder.push_front(key);
+        m_windowItems.insert(key, m_windowOrder.begin());
+
+        if (m_windowItems.size() > m_windowCapacity)
+        {
+            quint32 candidate = m_windowOrder.back();
+            m_windowItems.remove(candidate);
+            m_windowOrder.pop_back();
+
+            if (m_mainItems.size() < m_mainCapacity)
+            {
+                m_mainOrder.push_front(candidate);
+                m_mainItems.insert(candidate, m_mainOrder.begin());
+            }
+            else if (m_sketch.frequency(qHash(candidate)) > m_sketch.frequency(qHash(m_mainOrder.back())))
+            {
+                m_mainItems.remove(m_mainOrder.back());
+                m_mainOrder.pop_back();
+                m_mainOrder.push_front(candidate);
+                m_mainItems.insert(candidate, m_mainOrder.begin());
+            }
+        }
+
+        return false;
+    }
+};
+
+template<typename Policy>
+static double hitRatio(const Trace &trace, int capacity)
+{
+    Policy policy(capacity);
+    int hits = 0;
+
+    for(int i = 0; i < trace.size(); ++i)
+    {
+        if (policy.access(trace[i]))
+        {
+            ++hits;
+        }
+    }
+
+    return trace.isEmpty() ? 0.0 : static_cast<double>(hits) / trace.size();
+}
+
+class ZipfGenerator
+{
+    QVector<double> m_cumulative;
+    std::uniform_real_distribution<double> m_uniform;
+
+public:
+    ZipfGenerator(int keyCount, double skew)
+        :m_cumulative(),
+          m_uniform(0.0, 1.0)
+    {
+        m_cumulative.reserve(keyCount);
+        double sum = 0.0;
+
+        for(int i = 1; i <= keyCount; ++i)
+        {
+            sum += 1.0 / std::pow(i, skew);
+            m_cumulative.push_back(sum);
+        }
+
+        for(int i = 0; i < m_cumulative.size(); ++i)
+        {
+            m_cumulative[i] /= sum;
+        }
+    }
+
+    quint32 operator()(std::mt19937_64 &random)
+    {
+        return static_cast<quint32>(std::lower_bound(m_cumulative.begin(), m_cumulative.end(), m_uniform(random)) - m_cumulative.begin());
+    }
+};
+
+// popular files requested with a Zipf distribution, like the bundles and images of a site
+static Trace skewedTrace(int keyCount, int length, double skew, std::mt19937_64 &random)
+{
+    ZipfGenerator zipf(keyCount, skew);
+    Trace trace;
+    trace.reserve(length);
+
+    for(int i = 0; i < length; ++i)
+    {
+        trace.push_back(zipf(random));
+    }
+
+    return trace;
+}
+
+// the same traffic, with a crawler walking files nobody else asks for in between
+static Trace scanTrace(int keyCount, int length, double skew, double scanShare, int scanLength, std::mt19937_64 &random)
+{
+    ZipfGenerator zipf(keyCount, skew);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    quint32 nextScanKey = static_cast<quint32>(keyCount);
+    Trace trace;
+    trace.reserve(length);
+
+    while (trace.size() < length)
+    {
+        if (uniform(random) < scanShare / scanLength)
+        {
+            for(int i = 0; i < scanLength && trace.size() < length; ++i)
+            {
+                trace.push_back(nextScanKey++);
+            }
+        }
+        else
+        {
+            trace.push_back(zipf(random));
+        }
+    }
+
+    return trace;
+}
+
+// one path per line, e.g. extracted from an access log
+static bool loadTrace(const QString &fileName, Trace &trace, int &keyCount)
+{
+    QFile file(fileName);
+
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        return false;
+    }
+
+    QHash<QByteArray, quint32> keys;
+
+    while (!file.atEnd())
+    {
+        QByteArray path = file.readLine().trimmed();
+
+        if (!path.isEmpty())
+        {
+            QHash<QByteArray, quint32>::const_iterator iter = keys.constFind(path);
+
+            if (iter == keys.constEnd())
+            {
+                iter = keys.insert(path, static_cast<quint32>(keys.size()));
+            }
+
+            trace.push_back(iter.value());
+        }
+    }
+
+    keyCount = keys.size();
+    return true;
+}
+
+static void report(QTextStream &out, const QString &name, const Trace &trace, int keyCount)
+{
+    out << name << ", " << trace.size() << " requests, " << keyCount << " popular files" << endl;
+    out << qSetFieldWidth(12) << "capacity" << "LRU" << "W-TinyLFU" << qSetFieldWidth(0) << endl;
+
+    const double capacityShares[] = {0.005, 0.01, 0.05, 0.1, 0.2};
+
+    for(double share : capacityShares)
+    {
+        int capacity = qMax(static_cast<int>(keyCount * share), 2);
+
+        out << qSetFieldWidth(12) << capacity
+            << QString::number(hitRatio<LruPolicy>(trace, capacity) * 100.0, 'f', 2) + "%"
+            << QString::number(hitRatio<WindowTinyLfuPolicy>(trace, capacity) * 100.0, 'f', 2) + "%"
+            << qSetFieldWidth(0) << endl;
+    }
+
+    out << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("CachePolicy");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the hit ratios of LRU and W-TinyLFU on skewed and scan heavy access traces.");
+    parser.addHelpOption();
+    QCommandLineOption traceOption(QStringList() << "t" << "trace", "Replays a trace file, one path per line, instead of the synthetic traces.", "file");
+    QCommandLineOption keysOption(QStringList() << "k" << "keys", "Number of distinct popular files in the synthetic traces.", "count", "100000");
+    QCommandLineOption lengthOption(QStringList() << "n" << "requests", "Number of requests in the synthetic traces.", "count", "2000000");
+    QCommandLineOption skewOption(QStringList() << "s" << "skew", "Zipf exponent of the popular files.", "exponent", "0.9");
+    parser.addOption(traceOption);
+    parser.addOption(keysOption);
+    parser.addOption(lengthOption);
+    parser.addOption(skewOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.isSet(traceOption))
+    {
+        Trace trace;
+        int keyCount = 0;
+
+        if (!loadTrace(parser.value(traceOption), trace, keyCount))
+        {
+            err << "can't read trace " << parser.value(traceOption) << endl;
+            return 1;
+        }
+
+        report(out, parser.value(traceOption), trace, keyCount);
+        return 0;
+    }
+
+    int keyCount = qMax(parser.value(keysOption).toInt(), 100);
+    int length = qMax(parser.value(lengthOption).toInt(), 1);
+    double skew = parser.value(skewOption).toDouble();
+    std::mt19937_64 random(42);
+
+    report(out, "skewed", skewedTrace(keyCount, length, skew, random), keyCount);
+    report(out, "skewed with 20% crawler scans", scanTrace(keyCount, length, skew, 0.2, 5000, random), keyCount);
+    report(out, "skewed with 50% crawler scans", scanTrace(keyCount, length, skew, 0.5, 5000, random), keyCount);
+
+    return 0;
+}
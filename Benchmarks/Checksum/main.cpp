@@ -0,0 +1,120 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <random>
+#include "Checksum.h"
+
+// Measures the throughput of each CRC-32 kernel, and of the content hashes used for entity tags, across buffer sizes.
+// Every size is processed repeatedly until about the same number of bytes has gone through, so small buffers show
+// the per call overhead and large ones the steady state. The kernels are checked against each other first.
+
+static double throughputInMBps(qint64 bytes, qint64 nanoseconds)
+{
+    return nanoseconds ? bytes * 1000.0 / nanoseconds : 0.0;
+}
+
+template<typename Function>
+static qint64 measure(const QByteArray &buffer, qint64 volume, Function function)
+{
+    qint64 iterations = qMax<qint64>(volume / qMax(buffer.size(), 1), 1);
+    // keeps the compiler from dropping the calls
+    volatile quint32 sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for(qint64 i = 0; i < iterations; ++i)
+    {
+        sink = sink + function(buffer);
+    }
+
+    return timer.nsecsElapsed() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("Checksum");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares the CRC-32 kernels and the entity tag hashes across buffer sizes.");
+    parser.addHelpOption();
+    QCommandLineOption volumeOption(QStringList() << "m" << "megabytes", "Megabytes processed per buffer size and implementation.", "count", "256");
+    parser.addOption(volumeOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    qint64 volume = qMax<qint64>(parser.value(volumeOption).toLongLong(), 1) * 1024 * 1024;
+    const int sizes[] = {64, 256, 1024, 4096, 16384, 65536, 1 << 20, 16 << 20};
+
+    std::mt19937 random(42);
+    QByteArray largest(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1], Qt::Uninitialized);
+    for(int i = 0; i < largest.size(); ++i)
+    {
+        largest[i] = static_cast<char>(random());
+    }
+
+    for(int k = 0; k < CRC32KernelCount; ++k)
+    {
+        CRC32Kernel kernel = static_cast<CRC32Kernel>(k);
+
+        if (!isCRC32KernelSupported(kernel))
+        {
+            err << crc32KernelName(kernel) << " is not supported by this CPU, skipped" << endl;
+        }
+        else if (crc32With(kernel, largest.constData(), largest.size() - 3) != crc32With(CRC32Kernel::Bytewise, largest.constData(), largest.size() - 3))
+        {
+            err << crc32KernelName(kernel) << " computes a wrong CRC-32" << endl;
+            return 1;
+        }
+    }
+
+    out << "MB/s" << endl;
+    out << qSetFieldWidth(14) << "size";
+    for(int k = 0; k < CRC32KernelCount; ++k)
+    {
+        out << crc32KernelName(static_cast<CRC32Kernel>(k));
+    }
+    out << "md5" << "contentETag" << qSetFieldWidth(0) << endl;
+
+    for(int size : sizes)
+    {
+        QByteArray buffer = QByteArray::fromRawData(largest.constData(), size);
+
+        out << qSetFieldWidth(14) << size;
+
+        for(int k = 0; k < CRC32KernelCount; ++k)
+        {
+            CRC32Kernel kernel = static_cast<CRC32Kernel>(k);
+
+            if (!isCRC32KernelSupported(kernel))
+            {
+                out << "-";
+                continue;
+            }
+
+            qint64 nanoseconds = measure(buffer, volume, [kernel](const QByteArray &data){
+                return crc32With(kernel, data.constData(), data.size());
+            });
+            out << QString::number(throughputInMBps(size, nanoseconds), 'f', 0);
+        }
+
+        qint64 md5 = measure(buffer, volume, [](const QByteArray &data){
+            return static_cast<quint32>(QCryptographicHash::hash(data, QCryptographicHash::Md5).at(0));
+        });
+        out << QString::number(throughputInMBps(size, md5), 'f', 0);
+
+        qint64 etag = measure(buffer, volume, [](const QByteArray &data){
+            return static_cast<quint32>(contentETag(data).size());
+        });
+        out << QString::number(throughputInMBps(size, etag), 'f', 0);
+
+        out << qSetFieldWidth(0) << endl;
+    }
+
+    return 0;
+}
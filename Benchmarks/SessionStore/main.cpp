@@ -0,0 +1,135 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QVector>
+#include <random>
+#include <thread>
+#include "SessionStore.h"
+
+// Runs the lookups SessionManager makes on every authenticated request against a session store, from several
+// threads at once, and prints the throughput at each thread count. Every thread replays the same seeded mix of
+// operations, so runs against the memory store can be compared with each other: mostly lookups of live sessions,
+// some of unknown ids, touches, and logins followed by logouts. The Mongo and tiered stores need a running mongod.
+
+static QByteArray sessionIdOf(quint64 index)
+{
+    return QByteArray::number(index, 16).rightJustified(64, '0');
+}
+
+static void run(SessionStore &store, quint32 sessionCount, int operations, quint32 seed, qint64 now)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<quint32> pick(0, sessionCount - 1);
+    std::uniform_int_distribution<int> kind(0, 99);
+    SessionStore::Session session;
+
+    for(int i = 0; i < operations; ++i)
+    {
+        int k = kind(random);
+
+        if (k < 90)
+        {
+            store.find(sessionIdOf(pick(random)), session);
+        }
+        else if (k < 93)
+        {
+            // not a session, a forged or stale cookie
+            store.find(sessionIdOf(sessionCount + pick(random)), session);
+        }
+        else if (k < 98)
+        {
+            store.touch(sessionIdOf(pick(random)), now);
+        }
+        else
+        {
+            QByteArray sessionId = sessionIdOf((static_cast<quint64>(seed) << 32) + static_cast<quint64>(i) + 2 * sessionCount);
+            session.m_time = now;
+            store.insert(sessionId, session);
+            store.remove(sessionId);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("SessionStore");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of a session store under the lookups of authenticated requests.");
+    parser.addHelpOption();
+    QCommandLineOption storeOption(QStringList() << "s" << "store", "The store, memory, mongodb or tiered.", "name", "memory");
+    QCommandLineOption sessionsOption(QStringList() << "n" << "sessions", "Live sessions in the store.", "count", "100000");
+    QCommandLineOption operationsOption(QStringList() << "o" << "operations", "Operations per thread.", "count", "1000000");
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads", "The largest thread count, every power of two up to it is run.", "count", "8");
+    parser.addOption(storeOption);
+    parser.addOption(sessionsOption);
+    parser.addOption(operationsOption);
+    parser.addOption(threadsOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QString name = parser.value(storeOption);
+    quint32 sessionCount = qMax(parser.value(sessionsOption).toUInt(), 1u);
+    int operations = qMax(parser.value(operationsOption).toInt(), 1);
+    int maximumThreads = qMax(parser.value(threadsOption).toInt(), 1);
+    qint64 now = static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t());
+
+    QScopedPointer<SessionStore> store(SessionStore::create(name, 3600 * 24 * 7));
+
+    if (store.isNull())
+    {
+        err << "unknown store " << name << endl;
+        return 1;
+    }
+
+    store->initialize();
+
+    SessionStore::Session session;
+    session.m_userId = "5b0f7f1d9c1e4a2b3c4d5e6f";
+    session.m_email = "user@example.com";
+    session.m_time = now;
+
+    for(quint32 i = 0; i < sessionCount; ++i)
+    {
+        store->insert(sessionIdOf(i), session);
+    }
+
+    out << "store " << name << ", " << sessionCount << " sessions, " << operations << " operations per thread" << endl;
+    out << "threads\tops/s\tns/op" << endl;
+
+    for(int threadCount = 1; threadCount <= maximumThreads; threadCount *= 2)
+    {
+        QVector<std::thread *> threads;
+        QElapsedTimer timer;
+        timer.start();
+
+        for(int t = 0; t < threadCount; ++t)
+        {
+            threads.push_back(new std::thread(run, std::ref(*store), sessionCount, operations, static_cast<quint32>(t + 1), now));
+        }
+
+        for(int t = 0; t < threadCount; ++t)
+        {
+            threads[t]->join();
+            delete threads[t];
+        }
+
+        qint64 elapsed = qMax<qint64>(timer.nsecsElapsed(), 1);
+        qint64 total = static_cast<qint64>(operations) * threadCount;
+
+        out << threadCount << "\t" << qRound64(total * 1e9 / elapsed) << "\t" << QString::number(static_cast<double>(elapsed) * threadCount / total, 'f', 1) << endl;
+    }
+
+    for(quint32 i = 0; i < sessionCount; ++i)
+    {
+        store->remove(sessionIdOf(i));
+    }
+
+    return 0;
+}
@@ -47,3 +47,5 @@ LIBS += -lbsoncxx
 RESOURCES +=
 
 DISTFILES +=
+
+include(../../Swiftly/Compression.pri)
@@ -3,44 +3,45 @@
 #include <QFileInfo>
 #include <QSharedPointer>
 #include <QString>
+#include "SettingsManager.h"
 
 StaticServer::StaticServer():
     WebApp(),
-    m_staticFileServer(QDir("/home/shiy/test"))
-{}
+    m_staticFileServer(staticFileServer())
+{
+}
+
+const StaticFileServer &StaticServer::staticFileServer()
+{
+    // set up once per process, each instance serves a copy that shares the bundle or the watched root
+    static StaticFileServer server = []()
+    {
+        StaticFileServer configured(QDir("/home/shiy/test"));
+        QString bundle = SettingsManager::getSingleton().get("StaticServer/bundle").toString();
+
+        // a bundle made by the Pack tool is served as is, there is nothing to watch or warm up
+        if (bundle.isEmpty() || !configured.useBundle(bundle))
+        {
+            // assets are picked up after a deployment without a restart, and served warm right after start
+            configured.watch(true);
+        }
+
+        return configured;
+    }();
+
+    return server;
+}
 
 void StaticServer::registerPathHandlers()
 {
-    AddGetHandler("/", handleFileGet);
+    addGet<&StaticServer::handleFileGet>("/");
 }
 
 void StaticServer::handleFileGet(HttpRequest &request, HttpResponse &response)
 {
     qDebug() << "-----------%%%" << request.getHeader().getPath();
 
-    bool compress = false;
-    if (request.getHeader().getHeaderInfo().contains("Accept-Encoding") )
-    {
-        if (request.getHeader().getHeaderInfo()["Accept-Encoding"]->contains("gzip"))
-        {
-            compress = true;
-        }
-    }
-
-    QByteArray fileContent;
-    QString mimeType;
-    QString md5;
-    if (m_staticFileServer.getFileByPath(request.getHeader().getPath(), fileContent, mimeType, md5, StaticFileServer::FileType::UNSPECIFIED, true, compress))
-    {
-        response << fileContent;
-        if (compress)
-        {
-            QSharedPointer<QString> gzipstr(new QString("gzip"));
-            response.setHeader("Content-Encoding", gzipstr);
-        }
-        response.finish(mimeType);
-    }
-    else
+    if (!m_staticFileServer.serve(request, response))
     {
         response.setStatusCode(404);
         response << "can't find the file!\n";
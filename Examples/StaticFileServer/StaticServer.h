@@ -12,6 +12,13 @@ class StaticServer : public WebApp
 public:
     StaticServer();
     void registerPathHandlers() override;
+
+    /*!
+     * \brief staticFileServer returns the file server every StaticServer copies, configured on the first call
+     *
+     * Watching the root and warming the cache happen there, once per process, however many instances the workers have.
+     */
+    static const StaticFileServer &staticFileServer();
 public slots:
     void handleFileGet(HttpRequest &,HttpResponse &);
 };
@@ -8,6 +8,9 @@ int main(int argc, char *argv[])
     qDebug() << "Example StaticFileServer";
     QCoreApplication a(argc, argv);
     REGISTER_WEBAPP(StaticServer);
+    HttpServer::getSingleton().setSharedRouteTable(true);
+    // watches the root and starts warming the cache before the workers take requests
+    StaticServer::staticFileServer();
     HttpServer::getSingleton().start(QThread::idealThreadCount(), 8083);
     return a.exec();
 }
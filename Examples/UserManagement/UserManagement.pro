@@ -54,3 +54,5 @@ LIBS += -L/usr/local/lib -lsodium
 LIBS += -L/Users/shiyan/mongodb/mongo-cxx-driver/build/install/lib
 LIBS += -lmongocxx
 LIBS += -lbsoncxx
+
+include(../../Swiftly/Compression.pri)
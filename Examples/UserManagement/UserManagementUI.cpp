@@ -2,22 +2,26 @@
 #include "SettingsManager.h"
 #include <QStringBuilder>
 #include "mustache.h"
+#include "AssetContext.h"
+#include "ResponseCache.h"
 
 UserManagementUI::UserManagementUI()
     :WebApp(),
       m_staticFileServer(QDir(SettingsManager::getSingleton().get("UserManagement/static_dir", "/home/shiy/startmin").toString())),
       m_templatePath(SettingsManager::getSingleton().get("UserManagement/template_path", ".").toString())
 {
-
+    // pages reference assets by fingerprinted URLs, browsers keep those without revalidating
+    m_staticFileServer.fingerprintAssets();
 }
 
 void UserManagementUI::registerPathHandlers()
 {
-    AddGetHandler("/signup", handleSignupUIGet);
-    AddGetHandler("/login", handleLoginUIGet);
+    // these pages are the same for every anonymous visitor
+    addGet<&UserManagementUI::handleSignupUIGet, ResponseCacheMiddleware<>>("/signup");
+    addGet<&UserManagementUI::handleLoginUIGet, ResponseCacheMiddleware<>>("/login");
     AddGetHandler("/activate", handleUserActivationUIGet);
     AddGetHandler("/resendActivationCode", handleResendActivationCodeUIGet);
-    AddGetHandler("/requestPasswordResetCode", handleRequestPasswordResetCodeUIGet);
+    addGet<&UserManagementUI::handleRequestPasswordResetCodeUIGet, ResponseCacheMiddleware<>>("/requestPasswordResetCode");
     AddGetHandler("/resetPassword", handleResetPasswordUIGet);
     AddGetHandler("/loggedInPage", handleLoggedInPageGet);
     AddGetHandler("/", handleFileGet);
@@ -25,12 +29,17 @@ void UserManagementUI::registerPathHandlers()
 
 void UserManagementUI::handleLoginUIGet(HttpRequest &request, HttpResponse &response)
 {
-    QByteArray fileContent;
+    QByteArray pageTemplate;
     QString mimeType;
     QString md5;
-    if (m_staticFileServer.getFileByAbsolutePath(m_templatePath % "/login.html", fileContent, mimeType, md5))
+    if (m_staticFileServer.getFileByAbsolutePath(m_templatePath % "/login.html", pageTemplate, mimeType, md5))
     {
-        response << fileContent;
+        Mustache::Renderer renderer;
+        AssetContext context(QVariantHash(), m_staticFileServer);
+
+        QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
+
+        response << content;
         response.finish(mimeType);
     }
     else
@@ -56,7 +65,7 @@ void UserManagementUI::handleSignupUIGet(HttpRequest &request, HttpResponse &res
         info["gitHub_oauth_link"] = QString("http://github.com/login/oauth/authorize?client_id=" % client_id % "&scpoe=" % scope);
 
         Mustache::Renderer renderer;
-        Mustache::QtVariantContext context(info);
+        AssetContext context(info, m_staticFileServer);
 
         QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
 
@@ -73,12 +82,17 @@ void UserManagementUI::handleSignupUIGet(HttpRequest &request, HttpResponse &res
 
 void UserManagementUI::handleRequestPasswordResetCodeUIGet(HttpRequest &request, HttpResponse &response)
 {
-    QByteArray fileContent;
+    QByteArray pageTemplate;
     QString mimeType;
     QString md5;
-    if (m_staticFileServer.getFileByAbsolutePath(m_templatePath % "/send_resetCode.html", fileContent, mimeType, md5))
+    if (m_staticFileServer.getFileByAbsolutePath(m_templatePath % "/send_resetCode.html", pageTemplate, mimeType, md5))
     {
-        response << fileContent;
+        Mustache::Renderer renderer;
+        AssetContext context(QVariantHash(), m_staticFileServer);
+
+        QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
+
+        response << content;
         response.finish(mimeType);
     }
     else
@@ -109,7 +123,7 @@ void UserManagementUI::handleResendActivationCodeUIGet(HttpRequest &request, Htt
         }
 
         Mustache::Renderer renderer;
-        Mustache::QtVariantContext context(info);
+        AssetContext context(info, m_staticFileServer);
 
         QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
 
@@ -126,15 +140,8 @@ void UserManagementUI::handleResendActivationCodeUIGet(HttpRequest &request, Htt
 
 void UserManagementUI::handleFileGet(HttpRequest &request,HttpResponse &response)
 {
-    QByteArray fileContent;
-    QString mimeType;
-    QString md5;
-    if (m_staticFileServer.getFileByPath(request.getHeader().getPath(), fileContent, mimeType, md5))
-    {
-        response << fileContent;
-        response.finish(mimeType);
-    }
-    else
+    // answers fingerprinted URLs too
+    if (!m_staticFileServer.serve(request, response))
     {
         response.setStatusCode(404);
         response << "can't find the file!\n";
@@ -180,7 +187,7 @@ void UserManagementUI::handleUserActivationUIGet(HttpRequest &request, HttpRespo
         info["activation_email"] = (*queries["email"]);
 
         Mustache::Renderer renderer;
-        Mustache::QtVariantContext context(info);
+        AssetContext context(info, m_staticFileServer);
 
         QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
 
@@ -210,7 +217,7 @@ void UserManagementUI::handleResetPasswordUIGet(HttpRequest &request, HttpRespon
         info["reset_email"] = *queries["email"].data();
 
         Mustache::Renderer renderer;
-        Mustache::QtVariantContext context(info);
+        AssetContext context(info, m_staticFileServer);
 
         QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
 
@@ -229,7 +236,7 @@ void UserManagementUI::handleResetPasswordUIGet(HttpRequest &request, HttpRespon
         info["reset_email"] = email;
 
         Mustache::Renderer renderer;
-        Mustache::QtVariantContext context(info);
+        AssetContext context(info, m_staticFileServer);
 
         QString content = renderer.render(QString::fromUtf8(pageTemplate), &context);
 
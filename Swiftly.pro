@@ -2,6 +2,10 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
           Swiftly \
-          Examples
+          Examples \
+          Tools \
+          Benchmarks
 
 Examples.depends = Swiftly
+Tools.depends = Swiftly
+Benchmarks.depends = Swiftly
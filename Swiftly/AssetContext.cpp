@@ -0,0 +1,26 @@
+#include "AssetContext.h"
+#include "StaticFileServer.h"
+
+static const QString assetKey = QStringLiteral("asset");
+
+AssetContext::AssetContext(const QVariant &root, const StaticFileServer &server)
+    :Mustache::QtVariantContext(root),
+      m_server(server)
+{
+}
+
+bool AssetContext::canEval(const QString &key) const
+{
+    return key == assetKey || Mustache::QtVariantContext::canEval(key);
+}
+
+QString AssetContext::eval(const QString &key, const QString &_template, Mustache::Renderer *renderer)
+{
+    if (key != assetKey)
+    {
+        return Mustache::QtVariantContext::eval(key, _template, renderer);
+    }
+
+    // the section is the logical path, "{{#asset}} /css/site.css {{/asset}}" works as well
+    return m_server.assetUrl(renderer->render(_template, this).trimmed());
+}
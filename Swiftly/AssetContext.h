@@ -0,0 +1,25 @@
+#ifndef ASSETCONTEXT_H
+#define ASSETCONTEXT_H
+
+#include "mustache.h"
+
+class StaticFileServer;
+
+/*! \brief AssetContext is a Mustache context that rewrites asset references to their fingerprinted URLs
+ *
+ * {{#asset}}/css/site.css{{/asset}} renders as the URL StaticFileServer::assetUrl() gives for the path, which may
+ * itself contain tags. Every other key is looked up in the variant map, as with Mustache::QtVariantContext.
+ */
+class AssetContext : public Mustache::QtVariantContext
+{
+    const StaticFileServer &m_server;
+
+public:
+    //! \param[in] server resolves the references, it must outlive the context
+    AssetContext(const QVariant &root, const StaticFileServer &server);
+
+    bool canEval(const QString &key) const override;
+    QString eval(const QString &key, const QString &_template, Mustache::Renderer *renderer) override;
+};
+
+#endif // ASSETCONTEXT_H
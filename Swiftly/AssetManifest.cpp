@@ -0,0 +1,224 @@
+#include "AssetManifest.h"
+#include <QMutex>
+#include <QStringBuilder>
+
+static QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static QHash<QString, QSharedPointer<AssetManifest>> &registry()
+{
+    static QHash<QString, QSharedPointer<AssetManifest>> manifests;
+    return manifests;
+}
+
+static bool isFingerprint(const QString &part)
+{
+    if (part.size() != AssetManifest::m_fingerprintLength)
+    {
+        return false;
+    }
+
+    for(int i = 0; i < part.size(); ++i)
+    {
+        ushort c = part.at(i).unicode();
+
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+AssetManifest::AssetManifest()
+    :m_lock(),
+      m_assets(),
+      m_logicalPaths()
+{
+}
+
+QSharedPointer<AssetManifest> AssetManifest::forRoot(const QString &canonicalRootPath, bool *created)
+{
+    QMutexLocker locker(&registryMutex());
+    QSharedPointer<AssetManifest> &manifest = registry()[canonicalRootPath];
+
+    if (created)
+    {
+        *created = manifest.isNull();
+    }
+
+    if (manifest.isNull())
+    {
+        manifest.reset(new AssetManifest());
+    }
+
+    return manifest;
+}
+
+QSharedPointer<AssetManifest> AssetManifest::findRoot(const QString &canonicalRootPath)
+{
+    QMutexLocker locker(&registryMutex());
+    return registry().value(canonicalRootPath);
+}
+
+void AssetManifest::insert(const QString &logicalPath, const QString &etag)
+{
+    Asset asset;
+    asset.m_fingerprint = fingerprint(etag);
+
+    if (asset.m_fingerprint.size() != m_fingerprintLength)
+    {
+        // not a content hash, such a file keeps its logical path
+        remove(logicalPath);
+        return;
+    }
+
+    asset.m_url = fingerprintedPath(logicalPath, asset.m_fingerprint);
+
+    QWriteLocker locker(&m_lock);
+    QHash<QString, Asset>::Iterator iter = m_assets.find(logicalPath);
+
+    if (iter != m_assets.end())
+    {
+        if (iter->m_fingerprint == asset.m_fingerprint)
+        {
+            return;
+        }
+
+        m_logicalPaths.remove(iter->m_url);
+        *iter = asset;
+    }
+    else
+    {
+        m_assets.insert(logicalPath, asset);
+    }
+
+    m_logicalPaths.insert(asset.m_url, logicalPath);
+}
+
+void AssetManifest::remove(const QString &logicalPath)
+{
+    QWriteLocker locker(&m_lock);
+    QHash<QString, Asset>::Iterator iter = m_assets.find(logicalPath);
+
+    if (iter != m_assets.end())
+    {
+        m_logicalPaths.remove(iter->m_url);
+        m_assets.erase(iter);
+    }
+}
+
+QStringList AssetManifest::logicalPathsUnder(const QString &logicalDirectoryPath) const
+{
+    QStringList logicalPaths;
+    QReadLocker locker(&m_lock);
+
+    for(QHash<QString, Asset>::ConstIterator iter = m_assets.constBegin(); iter != m_assets.constEnd(); ++iter)
+    {
+        if (iter.key().startsWith(logicalDirectoryPath))
+        {
+            logicalPaths.push_back(iter.key());
+        }
+    }
+
+    return logicalPaths;
+}
+
+int AssetManifest::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_assets.size();
+}
+
+QString AssetManifest::url(const QString &logicalPath) const
+{
+    QReadLocker locker(&m_lock);
+    QHash<QString, Asset>::ConstIterator iter = m_assets.constFind(logicalPath);
+
+    return iter != m_assets.constEnd() ? iter->m_url : logicalPath;
+}
+
+AssetManifest::Match AssetManifest::resolve(const QString &url, QString &logicalPath, QString &fingerprint) const
+{
+    QReadLocker locker(&m_lock);
+    QHash<QString, QString>::ConstIterator iter = m_logicalPaths.constFind(url);
+
+    if (iter != m_logicalPaths.constEnd())
+    {
+        logicalPath = iter.value();
+        fingerprint = m_assets.value(logicalPath).m_fingerprint;
+        return Match::Current;
+    }
+
+    // "/a/b.<fingerprint>.css", or "/a/b.<fingerprint>" for a file without extension
+    int nameStart = url.lastIndexOf('/') + 1;
+    int lastDot = url.lastIndexOf('.');
+
+    if (lastDot <= nameStart)
+    {
+        return Match::None;
+    }
+
+    int previousDot = url.lastIndexOf('.', lastDot - 1);
+    QString candidate;
+
+    if (previousDot >= nameStart && isFingerprint(url.mid(previousDot + 1, lastDot - previousDot - 1)))
+    {
+        fingerprint = url.mid(previousDot + 1, lastDot - previousDot - 1);
+        candidate = url.left(previousDot) % url.midRef(lastDot);
+    }
+    else if (isFingerprint(url.mid(lastDot + 1)))
+    {
+        fingerprint = url.mid(lastDot + 1);
+        candidate = url.left(lastDot);
+    }
+    else
+    {
+        return Match::None;
+    }
+
+    if (!m_assets.contains(candidate))
+    {
+        return Match::None;
+    }
+
+    logicalPath = candidate;
+    return Match::Superseded;
+}
+
+QString AssetManifest::fingerprint(const QString &etag)
+{
+    int start = etag.startsWith("W/") ? 2 : 0;
+
+    if (etag.size() > start && etag.at(start) == '"')
+    {
+        ++start;
+    }
+
+    QString part = etag.mid(start, m_fingerprintLength).toLower();
+
+    return isFingerprint(part) ? part : QString();
+}
+
+bool AssetManifest::matches(const QString &etag, const QString &fingerprint)
+{
+    return !fingerprint.isEmpty() && AssetManifest::fingerprint(etag) == fingerprint;
+}
+
+QString AssetManifest::fingerprintedPath(const QString &logicalPath, const QString &fingerprint)
+{
+    int nameStart = logicalPath.lastIndexOf('/') + 1;
+    int lastDot = logicalPath.lastIndexOf('.');
+
+    // a leading dot starts a hidden file's name, not its extension
+    if (lastDot <= nameStart)
+    {
+        return logicalPath % "." % fingerprint;
+    }
+
+    return logicalPath.left(lastDot) % "." % fingerprint % logicalPath.midRef(lastDot);
+}
@@ -0,0 +1,90 @@
+#ifndef ASSETMANIFEST_H
+#define ASSETMANIFEST_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+
+/*! \brief AssetManifest maps the logical paths of static files to URLs fingerprinted with their content hash
+ *
+ * "/js/app.js" is published as "/js/app.3fa9c1d2e4.js", the fingerprint being the start of the file's content hash.
+ * A fingerprinted URL always names the same bytes, browsers can keep it for good and never ask again, a new version
+ * of the file gets a new URL. See StaticFileServer::fingerprintAssets().
+ *
+ * Lookups run from every worker while files changing on disk are fingerprinted again from another thread.
+ */
+class AssetManifest
+{
+public:
+    enum class Match
+    {
+        //! not a fingerprinted URL of this manifest
+        None,
+        //! the fingerprint of the current content
+        Current,
+        //! a fingerprint the file had before it changed, e.g. in a page rendered before a deployment
+        Superseded
+    };
+
+    //! hex digits of the content hash kept in URLs
+    static const int m_fingerprintLength = 10;
+
+private:
+    class Asset
+    {
+    public:
+        QString m_url;
+        QString m_fingerprint;
+    };
+
+    mutable QReadWriteLock m_lock;
+    // by logical path
+    QHash<QString, Asset> m_assets;
+    // logical path by fingerprinted URL
+    QHash<QString, QString> m_logicalPaths;
+
+public:
+    AssetManifest();
+
+    /*!
+     * \brief forRoot returns the manifest shared by every server of a root directory
+     * \param[out] created set to true for the caller that made it, the one that should fill it
+     */
+    static QSharedPointer<AssetManifest> forRoot(const QString &canonicalRootPath, bool *created = nullptr);
+
+    //! \brief findRoot returns the manifest of a root directory, null if none has been made, see forRoot()
+    static QSharedPointer<AssetManifest> findRoot(const QString &canonicalRootPath);
+
+    //! \brief insert publishes a file under the fingerprint of its entity tag, replacing its previous fingerprint
+    void insert(const QString &logicalPath, const QString &etag);
+
+    void remove(const QString &logicalPath);
+
+    //! \brief logicalPathsUnder lists the files published under a directory, e.g. "/css/"
+    QStringList logicalPathsUnder(const QString &logicalDirectoryPath) const;
+
+    int size() const;
+
+    //! \brief url returns the fingerprinted URL of a file, or its logical path if it hasn't been fingerprinted
+    QString url(const QString &logicalPath) const;
+
+    /*!
+     * \brief resolve maps a requested URL back to the file it was made from
+     * \param[out] logicalPath the path of the file, set unless None is returned
+     * \param[out] fingerprint the fingerprint in the URL, set unless None is returned
+     */
+    Match resolve(const QString &url, QString &logicalPath, QString &fingerprint) const;
+
+    //! \brief fingerprint returns the part of a content hash entity tag used in URLs
+    static QString fingerprint(const QString &etag);
+
+    //! \brief matches tells if an entity tag is the content hash a fingerprint was taken from
+    static bool matches(const QString &etag, const QString &fingerprint);
+
+    //! \brief fingerprintedPath inserts a fingerprint before the extension of a path, "/a/b.css" gives "/a/b.<fingerprint>.css"
+    static QString fingerprintedPath(const QString &logicalPath, const QString &fingerprint);
+};
+
+#endif // ASSETMANIFEST_H
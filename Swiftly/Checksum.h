@@ -0,0 +1,46 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <QByteArray>
+#include <QString>
+
+/*!
+ * \brief CRC32Kernel lists the implementations of the gzip CRC-32 (polynomial 0xedb88320)
+ *
+ * crc32() picks the fastest one the CPU supports, once, the first time it is called. The others are there for
+ * crc32With(), to check and benchmark the kernels against each other.
+ */
+enum class CRC32Kernel
+{
+    //! one table lookup per byte
+    Bytewise = 0,
+    //! eight tables, eight bytes per step
+    SlicingBy8,
+    //! folds 64 bytes per step with PCLMULQDQ, x86 with PCLMUL and SSE4.1 only
+    CarrylessMultiply
+};
+
+const int CRC32KernelCount = 3;
+
+const char *crc32KernelName(CRC32Kernel kernel);
+
+bool isCRC32KernelSupported(CRC32Kernel kernel);
+
+/*!
+ * \brief crc32 computes the CRC-32 of a buffer with the fastest kernel
+ * \param[in] crc the CRC-32 of the data before this buffer, to checksum a stream in parts, 0 to start
+ */
+quint32 crc32(const char *data, qint64 size, quint32 crc = 0);
+
+//! \brief crc32With computes the CRC-32 of a buffer with a given kernel, which must be supported
+quint32 crc32With(CRC32Kernel kernel, const char *data, qint64 size, quint32 crc = 0);
+
+/*!
+ * \brief contentETag returns a strong entity tag for content, quoted
+ *
+ * The 128 bit xxHash3 of the content when the library is built with SWIFTLY_HAS_XXHASH, see Compression.pri, its
+ * md5 otherwise. Both are as unlikely to collide for entity tags, xxHash3 hashes an order of magnitude faster.
+ */
+QString contentETag(const QByteArray &content);
+
+#endif // CHECKSUM_H
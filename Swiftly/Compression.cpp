@@ -0,0 +1,244 @@
+#include "Compression.h"
+#include "Checksum.h"
+#include <QDataStream>
+#include <algorithm>
+
+#ifdef SWIFTLY_HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef SWIFTLY_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+quint32 crc32buf(const QByteArray& data)
+{
+    return crc32(data.constData(), data.size());
+}
+
+QByteArray gzipCompress(const QByteArray& data, int compressionLevel)
+{
+    auto compressedData = qCompress(data, compressionLevel);
+    //  Strip the first six bytes (a 4-byte length put on by qCompress and a 2-byte zlib header)
+    // and the last four bytes (a zlib integrity check).
+    compressedData.remove(0, 6);
+    compressedData.chop(4);
+
+    QByteArray header;
+    QDataStream ds1(&header, QIODevice::WriteOnly);
+    // Prepend a generic 10-byte gzip header (see RFC 1952),
+    ds1 << quint16(0x1f8b)
+        << quint16(0x0800)
+        << quint16(0x0000)
+        << quint16(0x0000)
+        << quint16(0x000b);
+
+    // Append a four-byte CRC-32 of the uncompressed data
+    // Append 4 bytes uncompressed input size modulo 2^32
+    QByteArray footer;
+    QDataStream ds2(&footer, QIODevice::WriteOnly);
+    ds2.setByteOrder(QDataStream::LittleEndian);
+    ds2 << crc32buf(data)
+        << quint32(data.size());
+
+    return header + compressedData + footer;
+}
+
+
+bool isCompressibleMimeType(const QString &mimeType)
+{
+    return mimeType.startsWith("text/")
+            || mimeType.startsWith("application/json")
+            || mimeType.startsWith("application/javascript")
+            || mimeType.startsWith("application/xml")
+            || mimeType.startsWith("image/svg+xml");
+}
+
+bool isWorthCompressing(const QString &mimeType, int size)
+{
+    const int minimumCompressionSize = 1024;
+
+    return size >= minimumCompressionSize && isCompressibleMimeType(mimeType);
+}
+
+QString contentEncodingName(ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ContentEncoding::GZip:
+        return "gzip";
+    case ContentEncoding::Zstd:
+        return "zstd";
+    case ContentEncoding::Brotli:
+        return "br";
+    default:
+        return "identity";
+    }
+}
+
+QString contentEncodingSuffix(ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ContentEncoding::GZip:
+        return ".gz";
+    case ContentEncoding::Zstd:
+        return ".zst";
+    case ContentEncoding::Brotli:
+        return ".br";
+    default:
+        return QString();
+    }
+}
+
+bool isContentEncodingSupported(ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ContentEncoding::Identity:
+    case ContentEncoding::GZip:
+        return true;
+#ifdef SWIFTLY_HAS_ZSTD
+    case ContentEncoding::Zstd:
+        return true;
+#endif
+#ifdef SWIFTLY_HAS_BROTLI
+    case ContentEncoding::Brotli:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+#ifdef SWIFTLY_HAS_BROTLI
+static QByteArray brotliCompress(const QByteArray &data)
+{
+    size_t encodedSize = BrotliEncoderMaxCompressedSize(static_cast<size_t>(data.size()));
+    QByteArray encoded(static_cast<int>(encodedSize), Qt::Uninitialized);
+
+    if (BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                              static_cast<size_t>(data.size()), reinterpret_cast<const uint8_t*>(data.constData()),
+                              &encodedSize, reinterpret_cast<uint8_t*>(encoded.data())) != BROTLI_TRUE)
+    {
+        return QByteArray();
+    }
+
+    encoded.resize(static_cast<int>(encodedSize));
+    return encoded;
+}
+#endif
+
+#ifdef SWIFTLY_HAS_ZSTD
+static QByteArray zstdCompress(const QByteArray &data)
+{
+    QByteArray encoded(static_cast<int>(ZSTD_compressBound(static_cast<size_t>(data.size()))), Qt::Uninitialized);
+
+    // RFC 9659 lets decoders refuse windows over 8 MiB, levels above 19 use up to 128 MiB, so the window is capped too
+    ZSTD_CCtx *context = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, 19);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_windowLog, 23);
+
+    size_t encodedSize = ZSTD_compress2(context, encoded.data(), static_cast<size_t>(encoded.size()),
+                                        data.constData(), static_cast<size_t>(data.size()));
+    ZSTD_freeCCtx(context);
+
+    if (ZSTD_isError(encodedSize))
+    {
+        return QByteArray();
+    }
+
+    encoded.resize(static_cast<int>(encodedSize));
+    return encoded;
+}
+#endif
+
+QByteArray compressContent(const QByteArray &data, ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case ContentEncoding::GZip:
+        return gzipCompress(data, 9);
+#ifdef SWIFTLY_HAS_ZSTD
+    case ContentEncoding::Zstd:
+        return zstdCompress(data);
+#endif
+#ifdef SWIFTLY_HAS_BROTLI
+    case ContentEncoding::Brotli:
+        return brotliCompress(data);
+#endif
+    default:
+        return QByteArray();
+    }
+}
+
+QVector<ContentEncoding> acceptedContentEncodings(const QString &acceptEncoding)
+{
+    QVector<ContentEncoding> accepted;
+
+    if (acceptEncoding.isNull())
+    {
+        accepted.push_back(ContentEncoding::Identity);
+        return accepted;
+    }
+
+    // -1 for codings the header doesn't mention
+    double qualities[ContentEncodingCount] = {-1.0, -1.0, -1.0, -1.0};
+    double wildcardQuality = -1.0;
+
+    QVector<QStringRef> codings = acceptEncoding.splitRef(',', QString::SkipEmptyParts);
+
+    for(QVector<QStringRef>::ConstIterator iter = codings.constBegin(); iter != codings.constEnd(); ++iter)
+    {
+        QVector<QStringRef> parameters = iter->split(';');
+        QStringRef coding = parameters[0].trimmed();
+        double quality = 1.0;
+
+        for(int i = 1; i < parameters.size(); ++i)
+        {
+            QStringRef parameter = parameters[i].trimmed();
+
+            if (parameter.startsWith("q="))
+            {
+                quality = parameter.mid(2).toDouble();
+            }
+        }
+
+        if (coding == "*")
+        {
+            wildcardQuality = quality;
+            continue;
+        }
+
+        for(int i = 0; i < ContentEncodingCount; ++i)
+        {
+            if (coding.compare(contentEncodingName(static_cast<ContentEncoding>(i)), Qt::CaseInsensitive) == 0
+                    || (i == static_cast<int>(ContentEncoding::GZip) && coding.compare(QLatin1String("x-gzip"), Qt::CaseInsensitive) == 0))
+            {
+                qualities[i] = quality;
+            }
+        }
+    }
+
+    for(int i = 0; i < ContentEncodingCount; ++i)
+    {
+        if (qualities[i] < 0.0)
+        {
+            // identity is always acceptable unless explicitly refused
+            qualities[i] = wildcardQuality >= 0.0 ? wildcardQuality : (i == static_cast<int>(ContentEncoding::Identity) ? 0.001 : 0.0);
+        }
+
+        if (qualities[i] > 0.0)
+        {
+            accepted.push_back(static_cast<ContentEncoding>(i));
+        }
+    }
+
+    // the enum is ordered by preference, a stable sort keeps it for equal q-values
+    std::reverse(accepted.begin(), accepted.end());
+    std::stable_sort(accepted.begin(), accepted.end(), [&qualities](ContentEncoding a, ContentEncoding b){
+        return qualities[static_cast<int>(a)] > qualities[static_cast<int>(b)];
+    });
+
+    return accepted;
+}
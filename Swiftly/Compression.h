@@ -0,0 +1,83 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief ContentEncoding lists the codings the server can produce, in order of preference for equal q-values
+ *
+ * Brotli and zstd are only available when the library was built with SWIFTLY_HAS_BROTLI and SWIFTLY_HAS_ZSTD,
+ * see Compression.pri.
+ */
+enum class ContentEncoding
+{
+    Identity = 0,
+    GZip,
+    Zstd,
+    Brotli
+};
+
+const int ContentEncodingCount = 4;
+
+/*!
+ * \brief crc32buf computes the CRC-32 (polynomial 0xedb88320) of a buffer, as used by the gzip footer
+ */
+quint32 crc32buf(const QByteArray& data);
+
+/*!
+ * \brief gzipCompress wraps the deflate stream produced by qCompress into a gzip member (RFC 1952)
+ * \param[in] data the uncompressed data
+ * \param[in] compressionLevel zlib compression level, from 0 to 9, -1 for zlib's default
+ * \return the gzip encoded data, suitable for "Content-Encoding: gzip"
+ */
+QByteArray gzipCompress(const QByteArray& data, int compressionLevel = -1);
+
+/*!
+ * \brief isCompressibleMimeType tells if content of a mime type is worth compressing
+ *
+ * Text based types compress well. Images, audio and video are already compressed, running them through
+ * gzip only costs cpu.
+ */
+bool isCompressibleMimeType(const QString &mimeType);
+
+/*!
+ * \brief isWorthCompressing tells if a body should be compressed at all
+ *
+ * Besides the mime type, bodies smaller than about a network packet gain nothing from compression.
+ */
+bool isWorthCompressing(const QString &mimeType, int size);
+
+/*!
+ * \brief contentEncodingName returns the Content-Encoding token of an encoding, e.g. "br"
+ */
+QString contentEncodingName(ContentEncoding encoding);
+
+/*!
+ * \brief contentEncodingSuffix returns the file suffix of precompressed sidecars, e.g. ".br" for "app.js.br"
+ */
+QString contentEncodingSuffix(ContentEncoding encoding);
+
+/*!
+ * \brief isContentEncodingSupported tells if this build can produce an encoding
+ */
+bool isContentEncodingSupported(ContentEncoding encoding);
+
+/*!
+ * \brief compressContent encodes data at the highest compression level of the encoding
+ *
+ * Meant for content that is compressed once and served many times, it is slow.
+ * \return the encoded data, empty if the encoding isn't supported or failed
+ */
+QByteArray compressContent(const QByteArray &data, ContentEncoding encoding);
+
+/*!
+ * \brief acceptedContentEncodings parses an Accept-Encoding header (RFC 7231, 5.3.4)
+ * \param[in] acceptEncoding the header value, a null string if the request has none
+ * \return the known encodings the client accepts, most preferred first, whether or not this build can produce
+ * them, precompressed content may exist. Identity is included unless refused with "identity;q=0" or "*;q=0".
+ */
+QVector<ContentEncoding> acceptedContentEncodings(const QString &acceptEncoding);
+
+#endif // COMPRESSION_H
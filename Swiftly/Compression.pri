@@ -0,0 +1,20 @@
+# Optional libraries used by Compression.cpp and Checksum.cpp.
+# libSwiftly is a static library and doesn't carry its dependencies, every project linking it includes this file too.
+
+CONFIG += link_pkgconfig
+
+packagesExist(libbrotlienc) {
+    DEFINES += SWIFTLY_HAS_BROTLI
+    PKGCONFIG += libbrotlienc
+}
+
+packagesExist(libzstd) {
+    DEFINES += SWIFTLY_HAS_ZSTD
+    PKGCONFIG += libzstd
+}
+
+# entity tags of static files, md5 without it
+packagesExist(libxxhash) {
+    DEFINES += SWIFTLY_HAS_XXHASH
+    PKGCONFIG += libxxhash
+}
@@ -0,0 +1,80 @@
+#include "FrequencySketch.h"
+#include <QtGlobal>
+
+static const quint64 rowSeeds[] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+
+FrequencySketch::FrequencySketch(int width)
+    :m_counters(),
+      m_mask(0),
+      m_additions(0),
+      m_sampleSize(0)
+{
+    quint32 roundedWidth = 1;
+
+    while (roundedWidth < static_cast<quint32>(qMax(width, 16)))
+    {
+        roundedWidth <<= 1;
+    }
+
+    m_counters.fill(0, static_cast<int>(roundedWidth) * m_rowCount);
+    m_mask = roundedWidth - 1;
+    m_sampleSize = static_cast<int>(roundedWidth) * 10;
+}
+
+int FrequencySketch::indexOf(uint hash, int row) const
+{
+    // each row mixes the hash with its own seed, keys colliding in one row rarely collide in the others
+    quint64 mixed = (static_cast<quint64>(hash) + rowSeeds[row]) * rowSeeds[row];
+    return row * static_cast<int>(m_mask + 1) + static_cast<int>((mixed >> 32) & m_mask);
+}
+
+void FrequencySketch::increment(uint hash)
+{
+    bool incremented = false;
+
+    for(int row = 0; row < m_rowCount; ++row)
+    {
+        quint8 &counter = m_counters[indexOf(hash, row)];
+
+        if (counter < m_maximumCount)
+        {
+            ++counter;
+            incremented = true;
+        }
+    }
+
+    if (incremented && ++m_additions >= m_sampleSize)
+    {
+        age();
+    }
+}
+
+int FrequencySketch::frequency(uint hash) const
+{
+    int result = m_maximumCount;
+
+    for(int row = 0; row < m_rowCount; ++row)
+    {
+        result = qMin<int>(result, m_counters[indexOf(hash, row)]);
+    }
+
+    return result;
+}
+
+void FrequencySketch::age()
+{
+    quint8 *counters = m_counters.data();
+
+    for(int i = 0; i < m_counters.size(); ++i)
+    {
+        counters[i] >>= 1;
+    }
+
+    m_additions /= 2;
+}
+
+void FrequencySketch::clear()
+{
+    m_counters.fill(0);
+    m_additions = 0;
+}
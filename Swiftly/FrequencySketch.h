@@ -0,0 +1,36 @@
+#ifndef FREQUENCYSKETCH_H
+#define FREQUENCYSKETCH_H
+
+#include <QVector>
+
+/*! \brief FrequencySketch estimates how often a key has been seen recently, in a fixed amount of memory
+ *
+ * It is a count-min sketch, four rows of small saturating counters indexed by the key hash. The estimate is the
+ * smallest of the four counters, it may be too high when keys collide but never too low. Once the number of recorded
+ * accesses reaches ten times the width, every counter is halved, so files that were popular long ago fade out.
+ *
+ * It is not thread safe, StaticFileCache guards it with a mutex.
+ */
+class FrequencySketch
+{
+    static const int m_rowCount = 4;
+    static const quint8 m_maximumCount = 15;
+
+    QVector<quint8> m_counters;
+    quint32 m_mask;
+    int m_additions;
+    int m_sampleSize;
+
+    int indexOf(uint hash, int row) const;
+    void age();
+
+public:
+    //! \param[in] width the number of counters per row, rounded up to a power of two
+    FrequencySketch(int width = 65536);
+
+    void increment(uint hash);
+    int frequency(uint hash) const;
+    void clear();
+};
+
+#endif // FREQUENCYSKETCH_H
@@ -1,6 +1,7 @@
 #include "HttpHeader.h"
 #include <QStringList>
 #include <QStringBuilder>
+#include <QLocale>
 
 HttpHeader::HttpHeader()
     :QObject(),
@@ -130,6 +131,11 @@ void HttpHeader::setQueryString(const QString &queryString)
     }
 }
 
+const QString & HttpHeader::getQueryString() const
+{
+    return m_queryString;
+}
+
 void HttpHeader::setHttpMethod(HttpMethod httpMethod)
 {
     m_httpMethod = httpMethod;
@@ -216,3 +222,39 @@ void HttpHeader::setUrl(const QString &url)
 {
     m_url = url;
 }
+
+QString HttpHeader::toHttpDate(const QDateTime &dateTime)
+{
+    // the C locale, day and month names must be English whatever the system locale is
+    return QLocale::c().toString(dateTime.toUTC(), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+}
+
+QDateTime HttpHeader::fromHttpDate(const QString &httpDate)
+{
+    QDateTime dateTime = QLocale::c().toDateTime(httpDate.trimmed(), "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+    dateTime.setTimeSpec(Qt::UTC);
+    return dateTime;
+}
+
+bool HttpHeader::matchesETag(const QString &etagList, const QString &etag)
+{
+    QStringRef opaqueTag = etag.startsWith("W/") ? etag.midRef(2) : etag.midRef(0);
+    QVector<QStringRef> candidates = etagList.splitRef(',', QString::SkipEmptyParts);
+
+    for(QVector<QStringRef>::ConstIterator iter = candidates.constBegin(); iter != candidates.constEnd(); ++iter)
+    {
+        QStringRef candidate = iter->trimmed();
+
+        if (candidate.startsWith("W/"))
+        {
+            candidate = candidate.mid(2);
+        }
+
+        if (candidate == "*" || (!etag.isEmpty() && candidate == opaqueTag))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
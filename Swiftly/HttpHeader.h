@@ -8,6 +8,7 @@
 #include <QTextStream>
 #include <QSharedPointer>
 #include <QWeakPointer>
+#include <QDateTime>
 
 /*! \class HttpHeader
  * This class represents the Http Header of a Http request.
@@ -105,6 +106,8 @@ public:
 
     void setQueryString(const QString &queryString);
 
+    const QString & getQueryString() const;
+
     void setPath(const QString &path);
 
     const QString & getPath() const;
@@ -115,6 +118,18 @@ public:
 
     QString toString();
 
+    //! \brief toHttpDate formats a date as an IMF-fixdate (RFC 7231, 7.1.1.1), e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    static QString toHttpDate(const QDateTime &dateTime);
+
+    //! \brief fromHttpDate parses an IMF-fixdate, the result is invalid if the value isn't one
+    static QDateTime fromHttpDate(const QString &value);
+
+    /*!
+     * \brief matchesETag tells if an If-None-Match list names an entity tag, with the weak comparison of RFC 7232, 2.3.2
+     * \param[in] etagList the header value, "*" matches any tag
+     */
+    static bool matchesETag(const QString &etagList, const QString &etag);
+
 private:
     HttpMethod m_httpMethod;
 };
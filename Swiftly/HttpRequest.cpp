@@ -14,6 +14,7 @@ HttpRequest::HttpRequest(TcpSocket *socket)
       m_totalBytes(0),
       m_bytesHaveRead(0),
       m_rawHeader(),
+      m_coalescable(true),
       m_socket(socket)
 {
 }
@@ -27,6 +28,7 @@ HttpRequest::HttpRequest(const HttpRequest &in)
       m_totalBytes(in.m_totalBytes),
       m_bytesHaveRead(in.m_bytesHaveRead),
       m_rawHeader(in.m_rawHeader),
+      m_coalescable(in.m_coalescable),
       m_socket(in.m_socket)
 {
 }
@@ -40,6 +42,7 @@ void HttpRequest::operator=(const HttpRequest &in)
     m_totalBytes=in.m_totalBytes;
     m_bytesHaveRead=in.m_bytesHaveRead;
     m_rawHeader=in.m_rawHeader;
+    m_coalescable=in.m_coalescable;
     m_socket=in.m_socket;
 }
 
@@ -40,6 +40,8 @@ private:
     unsigned int m_bytesHaveRead;
 
     QString m_rawHeader;
+    // false once RequestCoalescer has given the request back to run on its own
+    bool m_coalescable;
     bool internalParseFormData(const QByteArray &rawData, const QString &boundary, QHash<QString, QVector<QSharedPointer<FormData>>> &realContent);
 
     class PatternTracer
@@ -145,6 +147,17 @@ public:
     bool parseFormData();
     void processCookies();
 
+    //! \brief setCoalescable lets CoalesceMiddleware join the request to a flight, or makes it run the handler itself
+    void setCoalescable(bool coalescable)
+    {
+        m_coalescable = coalescable;
+    }
+
+    bool isCoalescable() const
+    {
+        return m_coalescable;
+    }
+
     ~HttpRequest();
 
     void appendData(const char*,unsigned int);
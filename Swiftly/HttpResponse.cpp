@@ -1,5 +1,7 @@
 #include "HttpResponse.h"
 #include "TcpSocket.h"
+#include "Compression.h"
+#include "Checksum.h"
 
 
 HttpResponse::HttpResponse(TcpSocket *_socket)
@@ -10,7 +12,18 @@ HttpResponse::HttpResponse(TcpSocket *_socket)
       m_statusCode(200),
       m_cookies(),
       m_sessionId(),
-      m_hasFinished(false)
+      m_hasFinished(false),
+      m_gzipAccepted(false),
+      m_conditionalGet(false),
+      m_ifNoneMatch(),
+      m_timer(),
+      m_captureEnabled(false),
+      m_captured(),
+      m_deferred(false),
+      m_mappedBody(),
+      m_mappedOffset(0),
+      m_mappedLength(0),
+      m_mappedWritten(0)
 {
 }
 
@@ -22,7 +35,18 @@ HttpResponse::HttpResponse(const HttpResponse &in)
       m_statusCode(in.m_statusCode),
       m_cookies(in.m_cookies),
       m_sessionId(in.m_sessionId),
-      m_hasFinished(in.m_hasFinished)
+      m_hasFinished(in.m_hasFinished),
+      m_gzipAccepted(in.m_gzipAccepted),
+      m_conditionalGet(in.m_conditionalGet),
+      m_ifNoneMatch(in.m_ifNoneMatch),
+      m_timer(in.m_timer),
+      m_captureEnabled(in.m_captureEnabled),
+      m_captured(in.m_captured),
+      m_deferred(in.m_deferred),
+      m_mappedBody(in.m_mappedBody),
+      m_mappedOffset(in.m_mappedOffset),
+      m_mappedLength(in.m_mappedLength),
+      m_mappedWritten(in.m_mappedWritten)
 {
 
 }
@@ -36,6 +60,17 @@ void HttpResponse::operator=(const HttpResponse &in)
     m_sessionId = in.m_sessionId;
     m_cookies = in.m_cookies;
     m_hasFinished = in.m_hasFinished;
+    m_gzipAccepted = in.m_gzipAccepted;
+    m_conditionalGet = in.m_conditionalGet;
+    m_ifNoneMatch = in.m_ifNoneMatch;
+    m_timer = in.m_timer;
+    m_captureEnabled = in.m_captureEnabled;
+    m_captured = in.m_captured;
+    m_deferred = in.m_deferred;
+    m_mappedBody = in.m_mappedBody;
+    m_mappedOffset = in.m_mappedOffset;
+    m_mappedLength = in.m_mappedLength;
+    m_mappedWritten = in.m_mappedWritten;
 }
 
 HttpResponse::~HttpResponse()
@@ -71,20 +106,97 @@ void HttpResponse::write(const char* in,const size_t size)
     m_buffer.append(in,size);
 }
 
+void HttpResponse::applyConditionalGet()
+{
+    QString etag = getHeader("ETag");
+
+    if (etag.isEmpty())
+    {
+        // a mapped body is too large to be hashed per request, and a response the client may not store never comes
+        // back conditional, so an unconditional request for it isn't worth a hash either
+        if (!m_mappedBody.isNull() || (m_ifNoneMatch.isEmpty() && getHeader("Cache-Control").contains("no-store")))
+        {
+            return;
+        }
+
+        etag = contentETag(m_buffer);
+        setHeader("ETag", QSharedPointer<QString>(new QString(etag)));
+    }
+
+    if (m_ifNoneMatch.isEmpty())
+    {
+        return;
+    }
+
+    if (HttpHeader::matchesETag(m_ifNoneMatch, etag))
+    {
+        m_statusCode = 304;
+        m_buffer.clear();
+        m_mappedBody.clear();
+        m_mappedOffset = 0;
+        m_mappedLength = 0;
+    }
+}
+
+void HttpResponse::applyCompression(const QString &mimeType)
+{
+    if (!isWorthCompressing(mimeType, m_buffer.size()) || !getHeader("Content-Encoding").isEmpty())
+    {
+        return;
+    }
+
+    m_buffer = gzipCompress(m_buffer);
+    setHeader("Content-Encoding", QSharedPointer<QString>(new QString("gzip")));
+    setHeader("Vary", QSharedPointer<QString>(new QString("Accept-Encoding")));
+
+    // the entity is now a different representation of the same content
+    QString etag = getHeader("ETag");
+
+    if (!etag.isEmpty() && !etag.startsWith("W/"))
+    {
+        setHeader("ETag", QSharedPointer<QString>(new QString("W/" % etag)));
+    }
+}
+
 void HttpResponse::finish(const QString &typeOverride )
 {
+    // a deferred response is completed by whoever deferred it, see defer()
+    if (m_deferred)
+    {
+        return;
+    }
+
     if (!m_hasFinished)
     {
-        unsigned int bufferSize = static_cast<unsigned int>(m_buffer.size());
+        if (m_statusCode == 200 && m_conditionalGet)
+        {
+            applyConditionalGet();
+        }
+
+        if (m_statusCode == 200 && m_gzipAccepted)
+        {
+            applyCompression(typeOverride);
+        }
+
+        if (m_timer.isValid())
+        {
+            setHeader("Server-Timing", QSharedPointer<QString>(new QString("app;dur=" % QString::number(m_timer.nsecsElapsed() / 1000000.0, 'f', 3))));
+        }
+
+        qint64 bufferSize = m_mappedBody.isNull() ? m_buffer.size() : m_mappedLength;
 
         QString headerString;
 
         switch (m_statusCode)
         {
         case 200:
-            headerString = "HTTP/1.1 " % QString::number(m_statusCode) % " Ok\r\n"
+            headerString = okStatusLines(bufferSize, typeOverride);
+            break;
+        case 206:
+            // the type is passed whole, for multipart/byteranges it carries the boundary
+            headerString = "HTTP/1.1 206 Partial Content\r\n"
                            "Content-Length: " % QString::number(bufferSize) % "\r\n"
-                           "Content-Type: " % typeOverride % "; charset=\"utf-8\"\r\n";
+                           "Content-Type: " % typeOverride % "\r\n";
             break;
         case 302:
             headerString = "HTTP/1.1 302 Found\r\n"
@@ -110,6 +222,10 @@ void HttpResponse::finish(const QString &typeOverride )
         case 415:
             headerString = "HTTP/1.1 415 Unsupported Media Type\r\n";
             break;
+        case 416:
+            headerString = "HTTP/1.1 416 Range Not Satisfiable\r\n"
+                           "Content-Length: 0\r\n";
+            break;
         case 422:
             headerString = "HTTP/1.1 422 Unprocessable Entity\r\n";
             break;
@@ -123,39 +239,166 @@ void HttpResponse::finish(const QString &typeOverride )
             qDebug() << "unimplemented http status code";
         }
 
-        headerString = headerString % m_header.toString();
+        headerString = headerString % m_header.toString() % cookieHeader() % "\r\n";
 
-        QString cookieString("Set-Cookie: ");
+        QByteArray headerBytes = headerString.toUtf8();
 
-        if (!m_sessionId.isEmpty())
+        // a mapped body can be larger than a QByteArray, and copying it would defeat the mapping
+        if (m_captureEnabled && m_mappedBody.isNull())
         {
-            cookieString.append("ssid=").append(m_sessionId);
-            for(QHash<QString, QVariant>::Iterator iter = m_cookies.begin(); iter != m_cookies.end(); ++iter)
+            m_captured = headerBytes + m_buffer;
+        }
+
+        if (m_socket)
+        {
+            m_socket->write(headerBytes);
+
+            if (m_mappedBody.isNull())
             {
-                cookieString.append("&").append(iter.key()).append("=").append(iter.value().toString());
+                m_socket->write(m_buffer);
+            }
+            else
+            {
+                m_hasFinished = true;
+                writeMappedBody();
+                return;
             }
         }
-        else if(m_cookies.count() > 0)
+        m_hasFinished = true;
+    }
+}
+
+void HttpResponse::writeMappedBody()
+{
+    // the socket copies what it is given into its write buffer, the file goes through it a chunk at a time
+    const qint64 chunkSize = 256 * 1024;
+    const int stallTimeoutInMilliseconds = 1000 * 60 * 2;
+
+    const char *data = m_mappedBody->data() + m_mappedOffset;
+
+    while (m_mappedWritten < m_mappedLength && m_socket->bytesToWrite() <= chunkSize)
+    {
+        qint64 written = m_socket->write(data + m_mappedWritten, qMin(chunkSize, m_mappedLength - m_mappedWritten));
+
+        if (written < 0)
         {
-            QHash<QString, QVariant>::Iterator iter = m_cookies.begin();
+            // the client is gone, the worker discards the socket once it is disconnected
+            m_mappedWritten = m_mappedLength;
+            break;
+        }
 
-            cookieString.append(iter.key()).append("=").append(iter.value().toString());
+        m_mappedWritten += written;
+    }
 
-            for(++iter; iter != m_cookies.end(); ++iter)
-            {
-                cookieString.append("&").append(iter.key()).append("=").append(iter.value().toString());
-            }
+    if (m_mappedWritten < m_mappedLength)
+    {
+        // the rest follows from the event loop as the client reads, each chunk restarts the socket's timeout
+        connect(m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(writeMappedBody()), Qt::UniqueConnection);
+        m_socket->setTimeout(stallTimeoutInMilliseconds);
+        return;
+    }
+
+    m_mappedBody.clear();
+
+    // done within finish(), the worker closes the socket as usual, otherwise the worker has left it to us.
+    // What is still buffered is sent before the connection is closed.
+    if (disconnect(m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(writeMappedBody())))
+    {
+        m_socket->disconnectFromHost();
+    }
+}
+
+void HttpResponse::finishWithSerialized(const QByteArray &serialized)
+{
+    if (!m_hasFinished)
+    {
+        if (m_socket)
+        {
+            m_socket->write(serialized);
+            m_socket->flush();
+        }
+        m_hasFinished = true;
+    }
+}
+
+QString HttpResponse::okStatusLines(qint64 contentLength, const QString &mimeType)
+{
+    return "HTTP/1.1 200 Ok\r\n"
+           "Content-Length: " % QString::number(contentLength) % "\r\n"
+           "Content-Type: " % mimeType % "; charset=\"utf-8\"\r\n";
+}
+
+QString HttpResponse::cookieHeader() const
+{
+    if (m_sessionId.isEmpty() && m_cookies.isEmpty())
+    {
+        return QString();
+    }
+
+    QString cookieString("Set-Cookie: ");
+
+    if (!m_sessionId.isEmpty())
+    {
+        cookieString.append("ssid=").append(m_sessionId);
+        for(QHash<QString, QVariant>::ConstIterator iter = m_cookies.constBegin(); iter != m_cookies.constEnd(); ++iter)
+        {
+            cookieString.append("&").append(iter.key()).append("=").append(iter.value().toString());
+        }
+    }
+    else
+    {
+        QHash<QString, QVariant>::ConstIterator iter = m_cookies.constBegin();
+
+        cookieString.append(iter.key()).append("=").append(iter.value().toString());
+
+        for(++iter; iter != m_cookies.constEnd(); ++iter)
+        {
+            cookieString.append("&").append(iter.key()).append("=").append(iter.value().toString());
+        }
+    }
+
+    return cookieString % "; Path=/\r\n";
+}
+
+QByteArray HttpResponse::prepareHeader(qint64 contentLength, const QString &mimeType, HttpHeader &header)
+{
+    return QString(okStatusLines(contentLength, mimeType) % header.toString()).toUtf8();
+}
+
+void HttpResponse::finishWithPreparedHeader(const QByteArray &preparedHeader, const QByteArray &body)
+{
+    if (m_deferred)
+    {
+        return;
+    }
+
+    if (!m_hasFinished)
+    {
+        if (m_timer.isValid())
+        {
+            setHeader("Server-Timing", QSharedPointer<QString>(new QString("app;dur=" % QString::number(m_timer.nsecsElapsed() / 1000000.0, 'f', 3))));
         }
 
-        if ((!m_sessionId.isEmpty()) || (m_cookies.count() > 0))
+        // on a plain hit there is nothing to add, the prepared bytes and the body are handed over untouched
+        QByteArray extraHeader = QString(m_header.toString() % cookieHeader()).toUtf8();
+
+        if (m_captureEnabled)
         {
-            headerString = headerString % cookieString % "; Path=/\r\n";
+            m_captured = preparedHeader + extraHeader + "\r\n" + body;
         }
 
-        headerString = headerString % "\r\n";
+        if (m_socket)
+        {
+            m_socket->write(preparedHeader);
 
-        m_socket->write(headerString.toUtf8());
-        m_socket->write(m_buffer);
+            if (!extraHeader.isEmpty())
+            {
+                m_socket->write(extraHeader);
+            }
+
+            m_socket->write("\r\n", 2);
+            m_socket->write(body);
+        }
         m_hasFinished = true;
     }
 }
@@ -5,7 +5,9 @@
 #include <QtNetwork/QTcpSocket>
 #include <QtCore/QTextStream>
 #include <QtCore/QDataStream>
+#include <QtCore/QElapsedTimer>
 #include "HttpHeader.h"
+#include "MappedFile.h"
 
 class TcpSocket;
 
@@ -21,6 +23,28 @@ class HttpResponse:public QObject
     QString m_sessionId;
     bool m_hasFinished;
 
+    // set by middlewares, applied to the body by finish()
+    bool m_gzipAccepted;
+    bool m_conditionalGet;
+    QString m_ifNoneMatch;
+    QElapsedTimer m_timer;
+
+    bool m_captureEnabled;
+    QByteArray m_captured;
+    bool m_deferred;
+
+    // a body sent straight from a file mapping instead of m_buffer
+    QSharedPointer<MappedFile> m_mappedBody;
+    qint64 m_mappedOffset;
+    qint64 m_mappedLength;
+    // how much of the mapped body has been handed to the socket
+    qint64 m_mappedWritten;
+
+    void applyConditionalGet();
+    void applyCompression(const QString &mimeType);
+    QString cookieHeader() const;
+    static QString okStatusLines(qint64 contentLength, const QString &mimeType);
+
 public:
     HttpResponse(TcpSocket *_socket = nullptr);
     HttpResponse(const HttpResponse &in);
@@ -56,6 +80,108 @@ public:
         m_statusCode=_statusCode;
     }
 
+    int getStatusCode() const
+    {
+        return m_statusCode;
+    }
+
+    bool hasFinished() const
+    {
+        return m_hasFinished;
+    }
+
+    bool hasCookies() const
+    {
+        return !m_sessionId.isEmpty() || !m_cookies.isEmpty();
+    }
+
+    /*!
+     * \brief setSocket changes the socket finish() writes to
+     *
+     * With no socket, finish() only serializes the response, which is useful together with setCaptureEnabled().
+     */
+    void setSocket(TcpSocket *_socket)
+    {
+        m_socket = _socket;
+    }
+
+    //! \brief setCaptureEnabled makes finish() keep a copy of the serialized response, see getCaptured(), unless the body is mapped
+    void setCaptureEnabled(bool enabled)
+    {
+        m_captureEnabled = enabled;
+    }
+
+    //! \brief getCaptured returns the header and body bytes finish() has written, if capture was enabled
+    const QByteArray & getCaptured() const
+    {
+        return m_captured;
+    }
+
+    /*!
+     * \brief finishWithSerialized sends an already serialized response, header and body, as is
+     *
+     * The bytes are flushed right away so the client doesn't wait for the rest of the handler chain.
+     */
+    void finishWithSerialized(const QByteArray &serialized);
+
+    /*!
+     * \brief prepareHeader serializes the status line and header fields of a 200 response once, for reuse
+     * \param[in] header the fields every response of this content carries
+     * \return the header lines, without the blank line that ends the header, see finishWithPreparedHeader()
+     */
+    static QByteArray prepareHeader(qint64 contentLength, const QString &mimeType, HttpHeader &header);
+
+    /*!
+     * \brief finishWithPreparedHeader sends a 200 response made of a prepared header and a body, both as is
+     *
+     * Only the fields set on this response, cookies and Server-Timing are serialized per call, after the prepared
+     * ones. Conditional GET and compression are not applied, the caller has already taken care of them.
+     */
+    void finishWithPreparedHeader(const QByteArray &preparedHeader, const QByteArray &body);
+
+    /*!
+     * \brief defer tells the worker this response will be completed later, from another code path
+     *
+     * The worker then neither finishes nor closes the socket after the handler returns, and goes on serving other
+     * connections. Whoever completes the response is responsible for closing the socket. finish() and
+     * finishWithPreparedHeader() do nothing on a deferred response, it is completed with finishWithSerialized().
+     */
+    void defer()
+    {
+        m_deferred = true;
+    }
+
+    bool isDeferred() const
+    {
+        return m_deferred;
+    }
+
+    /*!
+     * \brief setMappedBody makes a part of a mapped file the body, instead of what has been written to the response
+     *
+     * finish() hands the mapping to the socket in chunks, the next one each time the previous has drained, so a large
+     * download holds a bounded amount of heap however big the file is, and the worker isn't blocked while it is sent.
+     * See isStreaming(). A mapped body is never captured, see setCaptureEnabled().
+     */
+    void setMappedBody(const QSharedPointer<MappedFile> &mapping, qint64 offset, qint64 length)
+    {
+        m_mappedBody = mapping;
+        m_mappedOffset = offset;
+        m_mappedLength = length;
+        m_mappedWritten = 0;
+    }
+
+    /*!
+     * \brief isStreaming tells if finish() left part of a mapped body to be written
+     *
+     * The response then disconnects the socket itself once the whole body has been handed over, the worker must not
+     * close it.
+     */
+    bool isStreaming() const
+    {
+        return !m_mappedBody.isNull() && m_hasFinished && m_mappedWritten < m_mappedLength;
+    }
+
     QString getHeader(const QString &headerField) const
     {
         QWeakPointer<QString> header = m_header.getHeaderInfo(headerField);
@@ -83,6 +209,48 @@ public:
 
     void redirectTo(QSharedPointer<QString> url);
 
+    /*!
+     * \brief setGZipAccepted marks that the client accepts gzip encoded content
+     *
+     * If no Content-Encoding has been set by the handler, finish() gzips a compressible body.
+     * Handlers that have a precompressed variant can check isGZipAccepted() and set Content-Encoding themselves.
+     */
+    void setGZipAccepted(bool accepted)
+    {
+        m_gzipAccepted = accepted;
+    }
+
+    bool isGZipAccepted() const
+    {
+        return m_gzipAccepted;
+    }
+
+    /*!
+     * \brief setConditionalGet makes finish() answer 304 if the entity tag matches
+     * \param[in] ifNoneMatch the If-None-Match header of the request
+     *
+     * The ETag header set by the handler is used as is if there is one, the body is only hashed when there is none,
+     * and not at all for a mapped body or an unconditional request of a no-store response.
+     */
+    void setConditionalGet(const QString &ifNoneMatch)
+    {
+        m_conditionalGet = true;
+        m_ifNoneMatch = ifNoneMatch;
+    }
+
+    //! \brief startTiming makes finish() report the time spent since this call in a Server-Timing header
+    void startTiming()
+    {
+        m_timer.start();
+    }
+
+    qint64 elapsedNanoseconds() const
+    {
+        return m_timer.isValid() ? m_timer.nsecsElapsed() : 0;
+    }
+
+private slots:
+    void writeMappedBody();
 };
 
 #endif // HTTPRESPONSE_H
@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const QString &canonicalPath, const QDateTime &lastModified)
+    :m_file(canonicalPath),
+      m_data(nullptr),
+      m_size(0),
+      m_lastModified(lastModified)
+{
+    // the file stays open, closing a QFile removes its mappings
+    if (!m_file.open(QFile::ReadOnly))
+    {
+        return;
+    }
+
+    m_size = m_file.size();
+
+    if (m_size <= 0)
+    {
+        return;
+    }
+
+    m_data = m_file.map(0, m_size);
+
+    if (m_data)
+    {
+        ::madvise(const_cast<uchar*>(m_data), static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+void MappedFile::adviseWillNeed(qint64 offset, qint64 length) const
+{
+    if (!m_data || offset >= m_size)
+    {
+        return;
+    }
+
+    // madvise wants a page aligned address, the mapping itself starts on a page
+    qint64 pageSize = ::sysconf(_SC_PAGESIZE);
+    qint64 alignedOffset = offset - offset % pageSize;
+    qint64 alignedLength = qMin(length + (offset - alignedOffset), m_size - alignedOffset);
+
+    ::madvise(const_cast<uchar*>(m_data) + alignedOffset, static_cast<size_t>(alignedLength), MADV_WILLNEED);
+}
+
+MappedFileRegistry::MappedFileRegistry()
+    :m_mutex(),
+      m_mappings()
+{
+}
+
+QSharedPointer<MappedFile> MappedFileRegistry::acquire(const QString &canonicalPath, qint64 size, const QDateTime &lastModified)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QSharedPointer<MappedFile> mapping = m_mappings.value(canonicalPath).toStrongRef();
+
+    if (!mapping.isNull() && mapping->size() == size && mapping->lastModified() == lastModified)
+    {
+        return mapping;
+    }
+
+    mapping = QSharedPointer<MappedFile>(new MappedFile(canonicalPath, lastModified));
+
+    // a file that changed between resolving and mapping isn't the one the caller wants to describe
+    if (!mapping->isValid() || mapping->size() != size)
+    {
+        return QSharedPointer<MappedFile>();
+    }
+
+    m_mappings.insert(canonicalPath, mapping);
+
+    // forget files nobody sends anymore
+    for(QHash<QString, QWeakPointer<MappedFile>>::iterator iter = m_mappings.begin(); iter != m_mappings.end();)
+    {
+        if (iter.value().isNull())
+        {
+            iter = m_mappings.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    return mapping;
+}
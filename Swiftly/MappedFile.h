@@ -0,0 +1,86 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+/*! \brief MappedFile is a read only memory mapping of a whole file
+ *
+ * Serving a large file from a mapping reads it from the page cache, the file isn't copied into the heap of every
+ * request sending it. The mapping is advised for sequential access, read ahead then keeps up with the socket.
+ *
+ * Files are expected to be replaced by renaming a new file into place, as deployments do. A file truncated in place
+ * while mapped makes readers of the lost pages crash with SIGBUS.
+ */
+class MappedFile
+{
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QDateTime m_lastModified;
+
+public:
+    MappedFile(const QString &canonicalPath, const QDateTime &lastModified);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isValid() const
+    {
+        return m_data != nullptr;
+    }
+
+    const char *data() const
+    {
+        return reinterpret_cast<const char*>(m_data);
+    }
+
+    qint64 size() const
+    {
+        return m_size;
+    }
+
+    const QDateTime &lastModified() const
+    {
+        return m_lastModified;
+    }
+
+    //! \brief adviseWillNeed starts reading a part of the file ahead, e.g. the range about to be sent
+    void adviseWillNeed(qint64 offset, qint64 length) const;
+};
+
+/*! \brief MappedFileRegistry shares the mapping of a file between all the requests sending it, on any worker
+ *
+ * Mappings are reference counted, a file is unmapped when the last response sending it is destroyed.
+ */
+class MappedFileRegistry
+{
+    QMutex m_mutex;
+    QHash<QString, QWeakPointer<MappedFile>> m_mappings;
+
+    MappedFileRegistry();
+
+public:
+    static MappedFileRegistry &getSingleton()
+    {
+        static MappedFileRegistry obj;
+        return obj;
+    }
+
+    /*!
+     * \brief acquire returns the mapping of a file, mapping it if it isn't yet, or if it changed since
+     * \param[in] canonicalPath the canonical path of the file
+     * \param[in] size the size of the file, as resolved for this request
+     * \param[in] lastModified the modification time of the file, as resolved for this request
+     * \return the mapping, null if the file can't be mapped, e.g. it is empty
+     */
+    QSharedPointer<MappedFile> acquire(const QString &canonicalPath, qint64 size, const QDateTime &lastModified);
+};
+
+#endif // MAPPEDFILE_H
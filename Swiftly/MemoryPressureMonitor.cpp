@@ -0,0 +1,190 @@
+#include "MemoryPressureMonitor.h"
+#include "StaticFileCache.h"
+#include "SettingsManager.h"
+#include <QDebug>
+#include <QFile>
+#include <QStringBuilder>
+#include <unistd.h>
+
+static const int pollIntervalInMilliseconds = 2000;
+// a minute without pressure before growing back
+static const int calmPollsBeforeGrowing = 30;
+
+// the directory of the process' cgroup v2, empty with cgroup v1 or no cgroup file system
+static QString cgroupDirectory()
+{
+    QFile cgroup("/proc/self/cgroup");
+
+    if (!cgroup.open(QFile::ReadOnly | QFile::Text))
+    {
+        return QString();
+    }
+
+    while (!cgroup.atEnd())
+    {
+        QByteArray line = cgroup.readLine().trimmed();
+
+        if (line.startsWith("0::"))
+        {
+            QString directory = "/sys/fs/cgroup" % QString::fromUtf8(line.mid(3));
+
+            if (directory.endsWith('/'))
+            {
+                directory.chop(1);
+            }
+
+            return directory;
+        }
+    }
+
+    return QString();
+}
+
+static qint64 readLimit(const QString &path)
+{
+    QFile file(path);
+
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        return 0;
+    }
+
+    bool ok = false;
+    // "max" when unlimited with v2, v1 reports a huge number instead
+    qint64 limit = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? limit : 0;
+}
+
+qint64 MemoryPressureMonitor::memoryLimit()
+{
+    qint64 physical = static_cast<qint64>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+    QString directory = cgroupDirectory();
+    qint64 limit = directory.isEmpty() ? 0 : readLimit(directory % "/memory.max");
+
+    if (limit <= 0)
+    {
+        limit = readLimit("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    }
+
+    return (limit > 0 && limit < physical) ? limit : physical;
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor()
+    :m_thread(),
+      m_timer(new QTimer()),
+      m_pressureFilePath(),
+      m_highThreshold(10.0),
+      m_lowThreshold(1.0),
+      m_calmPolls(0),
+      m_pressure(-100)
+{
+    m_timer->setInterval(pollIntervalInMilliseconds);
+    QObject::connect(m_timer, &QTimer::timeout, m_timer, [this](){ poll(); });
+
+    m_thread.setObjectName("MemoryPressureMonitor");
+    m_timer->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    m_thread.quit();
+    m_thread.wait();
+    delete m_timer;
+}
+
+void MemoryPressureMonitor::start()
+{
+    if (!SettingsManager::getSingleton().get("StaticFileCache/adaptToMemoryPressure", true).toBool())
+    {
+        return;
+    }
+
+    QString directory = cgroupDirectory();
+    QString pressureFilePath = (!directory.isEmpty() && QFile::exists(directory % "/memory.pressure")) ? directory % "/memory.pressure"
+                                                                                                        : QString("/proc/pressure/memory");
+
+    if (!QFile::exists(pressureFilePath))
+    {
+        qDebug() << "no memory pressure stall information, the static file cache keeps its budget";
+        return;
+    }
+
+    double highThreshold = SettingsManager::getSingleton().get("StaticFileCache/pressureHighPercent", 10.0).toDouble();
+    double lowThreshold = SettingsManager::getSingleton().get("StaticFileCache/pressureLowPercent", 1.0).toDouble();
+
+    QMetaObject::invokeMethod(m_timer, [this, pressureFilePath, highThreshold, lowThreshold](){
+        m_pressureFilePath = pressureFilePath;
+        m_highThreshold = highThreshold;
+        m_lowThreshold = lowThreshold;
+        m_timer->start();
+    }, Qt::QueuedConnection);
+}
+
+void MemoryPressureMonitor::poll()
+{
+    // e.g. "some avg10=0.31 avg60=0.12 avg300=0.02 total=1234"
+    QFile file(m_pressureFilePath);
+
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+    {
+        return;
+    }
+
+    QList<QByteArray> lines = file.readAll().split('\n');
+    double pressure = -1.0;
+
+    for(int i = 0; i < lines.size() && pressure < 0.0; ++i)
+    {
+        if (lines[i].startsWith("some "))
+        {
+            QList<QByteArray> fields = lines[i].split(' ');
+
+            for(int f = 1; f < fields.size(); ++f)
+            {
+                if (fields[f].startsWith("avg10="))
+                {
+                    pressure = fields[f].mid(6).toDouble();
+                    break;
+                }
+            }
+        }
+    }
+
+    if (pressure < 0.0)
+    {
+        return;
+    }
+
+    m_pressure.store(static_cast<int>(pressure * 100.0));
+
+    StaticFileCache &cache = StaticFileCache::getSingleton();
+    qint64 budget = cache.budgetInKB();
+    qint64 capacity = cache.capacityInKB();
+
+    if (pressure >= m_highThreshold)
+    {
+        m_calmPolls = 0;
+        qint64 shrunk = qMax(capacity * 3 / 4, budget / 10);
+
+        if (shrunk < capacity)
+        {
+            qDebug() << "memory pressure" << pressure << "% shrinks the static file cache to" << shrunk / 1024 << "MB";
+            cache.setCapacityInKB(shrunk);
+        }
+    }
+    else if (pressure <= m_lowThreshold)
+    {
+        if (capacity < budget && ++m_calmPolls >= calmPollsBeforeGrowing)
+        {
+            m_calmPolls = 0;
+            qint64 grown = qMin(capacity + budget / 10, budget);
+            qDebug() << "no memory pressure, the static file cache grows back to" << grown / 1024 << "MB";
+            cache.setCapacityInKB(grown);
+        }
+    }
+    else
+    {
+        m_calmPolls = 0;
+    }
+}
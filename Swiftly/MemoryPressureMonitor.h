@@ -0,0 +1,61 @@
+#ifndef MEMORYPRESSUREMONITOR_H
+#define MEMORYPRESSUREMONITOR_H
+
+#include <QThread>
+#include <QTimer>
+#include <QString>
+#include <QAtomicInteger>
+
+/*! \brief MemoryPressureMonitor resizes StaticFileCache with the memory pressure of the process' cgroup
+ *
+ * It polls the "some" avg10 line of the pressure stall information, memory.pressure of the cgroup with cgroup v2,
+ * /proc/pressure/memory otherwise, on a thread of its own. Above the high threshold, the share of time tasks waited for
+ * memory, the cache gives up a quarter of its capacity. After a while below the low threshold it grows back a tenth
+ * of its budget at a time, up to the budget. Without PSI, on older kernels and on macOS, the cache keeps its budget.
+ *
+ * Settings: StaticFileCache/adaptToMemoryPressure (true), StaticFileCache/pressureHighPercent (10),
+ * StaticFileCache/pressureLowPercent (1).
+ */
+class MemoryPressureMonitor
+{
+    QThread m_thread;
+    // lives on m_thread, so do the members below
+    QTimer *m_timer;
+    QString m_pressureFilePath;
+    double m_highThreshold;
+    double m_lowThreshold;
+    int m_calmPolls;
+    // the last avg10 reading, in hundredths of a percent
+    QAtomicInteger<int> m_pressure;
+
+    MemoryPressureMonitor();
+    ~MemoryPressureMonitor();
+
+    void poll();
+
+public:
+    static MemoryPressureMonitor &getSingleton()
+    {
+        static MemoryPressureMonitor obj;
+        return obj;
+    }
+
+    //! \brief start begins polling, if the settings allow it and the kernel reports pressure stall information
+    void start();
+
+    //! \brief pressure returns the last share of time spent waiting for memory, in percent, -1 when not monitored
+    double pressure() const
+    {
+        return m_pressure.load() / 100.0;
+    }
+
+    /*!
+     * \brief memoryLimit returns the memory available to the process, in bytes
+     *
+     * That is the cgroup limit, memory.max with cgroup v2, memory.limit_in_bytes with v1, when it is lower than the
+     * physical memory, so a container doesn't size itself after the host.
+     */
+    static qint64 memoryLimit();
+};
+
+#endif // MEMORYPRESSUREMONITOR_H
@@ -0,0 +1,119 @@
+#include "MemorySessionStore.h"
+#include <QDateTime>
+
+static qint64 currentTime()
+{
+    return static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t());
+}
+
+MemorySessionStore::MemorySessionStore(qint64 timeoutThreshold)
+    :SessionStore(),
+      m_stripes(),
+      m_timeoutThreshold(timeoutThreshold),
+      m_sweepInterval(0)
+{
+    // a hundredth of the threshold, a week long threshold sweeps every hour and a half
+    m_sweepInterval = qMax<qint64>(m_timeoutThreshold / 100, 1);
+}
+
+bool MemorySessionStore::insert(const QByteArray &sessionId, const Session &session)
+{
+    Stripe &stripe = stripeFor(sessionId);
+    qint64 now = currentTime();
+    QMutexLocker locker(&stripe.m_mutex);
+
+    sweepIfDue(stripe, now);
+
+    QHash<QByteArray, Session>::iterator iter = stripe.m_sessions.find(sessionId);
+
+    if (iter != stripe.m_sessions.end())
+    {
+        if (!isExpired(iter.value(), now))
+        {
+            return false;
+        }
+
+        iter.value() = session;
+        return true;
+    }
+
+    stripe.m_sessions.insert(sessionId, session);
+    return true;
+}
+
+bool MemorySessionStore::find(const QByteArray &sessionId, Session &session)
+{
+    Stripe &stripe = stripeFor(sessionId);
+    qint64 now = currentTime();
+    QMutexLocker locker(&stripe.m_mutex);
+    QHash<QByteArray, Session>::iterator iter = stripe.m_sessions.find(sessionId);
+
+    if (iter == stripe.m_sessions.end())
+    {
+        return false;
+    }
+
+    if (isExpired(iter.value(), now))
+    {
+        stripe.m_sessions.erase(iter);
+        return false;
+    }
+
+    session = iter.value();
+    return true;
+}
+
+bool MemorySessionStore::remove(const QByteArray &sessionId)
+{
+    Stripe &stripe = stripeFor(sessionId);
+    QMutexLocker locker(&stripe.m_mutex);
+
+    return stripe.m_sessions.remove(sessionId) > 0;
+}
+
+void MemorySessionStore::touch(const QByteArray &sessionId, qint64 time)
+{
+    Stripe &stripe = stripeFor(sessionId);
+    QMutexLocker locker(&stripe.m_mutex);
+    QHash<QByteArray, Session>::iterator iter = stripe.m_sessions.find(sessionId);
+
+    if (iter != stripe.m_sessions.end() && iter->m_time < time)
+    {
+        iter->m_time = time;
+    }
+}
+
+int MemorySessionStore::size()
+{
+    int size = 0;
+
+    for(int i = 0; i < m_stripeCount; ++i)
+    {
+        QMutexLocker locker(&m_stripes[i].m_mutex);
+        size += m_stripes[i].m_sessions.size();
+    }
+
+    return size;
+}
+
+void MemorySessionStore::sweepIfDue(Stripe &stripe, qint64 now)
+{
+    if (now < stripe.m_nextSweep)
+    {
+        return;
+    }
+
+    stripe.m_nextSweep = now + m_sweepInterval;
+
+    for(QHash<QByteArray, Session>::iterator iter = stripe.m_sessions.begin(); iter != stripe.m_sessions.end();)
+    {
+        if (isExpired(iter.value(), now))
+        {
+            iter = stripe.m_sessions.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef MEMORYSESSIONSTORE_H
+#define MEMORYSESSIONSTORE_H
+
+#include "SessionStore.h"
+#include <QHash>
+#include <QMutex>
+
+/*! \brief MemorySessionStore keeps sessions in the memory of the process
+ *
+ * Sessions are spread over lock stripes by the hash of their id, workers only contend when they hit the same stripe.
+ * A session unused for longer than the timeout threshold is dropped when it is looked up, and each stripe is swept
+ * for such sessions by the first write after its sweep interval, so sessions that are never seen again don't
+ * accumulate. Nothing runs in the background, the store behaves the same from one run to the next.
+ */
+class MemorySessionStore : public SessionStore
+{
+    class alignas(64) Stripe
+    {
+    public:
+        QMutex m_mutex;
+        QHash<QByteArray, Session> m_sessions;
+        // seconds since epoch
+        qint64 m_nextSweep;
+
+        Stripe()
+            :m_mutex(),
+              m_sessions(),
+              m_nextSweep(0)
+        {}
+    };
+
+    static const int m_stripeCount = 64;
+    Stripe m_stripes[m_stripeCount];
+    qint64 m_timeoutThreshold;
+    qint64 m_sweepInterval;
+
+    Stripe & stripeFor(const QByteArray &sessionId)
+    {
+        return m_stripes[qHash(sessionId) % m_stripeCount];
+    }
+
+    bool isExpired(const Session &session, qint64 now) const
+    {
+        return now - session.m_time > m_timeoutThreshold;
+    }
+
+    void sweepIfDue(Stripe &stripe, qint64 now);
+
+public:
+    //! \param[in] timeoutThreshold seconds a session may stay unused
+    MemorySessionStore(qint64 timeoutThreshold);
+
+    bool insert(const QByteArray &sessionId, const Session &session) override;
+    bool find(const QByteArray &sessionId, Session &session) override;
+    bool remove(const QByteArray &sessionId) override;
+    void touch(const QByteArray &sessionId, qint64 time) override;
+
+    bool isRemote() const override
+    {
+        return false;
+    }
+
+    int size();
+};
+
+#endif // MEMORYSESSIONSTORE_H
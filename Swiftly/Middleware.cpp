@@ -0,0 +1,26 @@
+#include "Middleware.h"
+#include "LoggingManager.h"
+#include "Compression.h"
+
+bool CompressionMiddleware::acceptsGZip(HttpRequest &request)
+{
+    QWeakPointer<QString> acceptEncoding = request.getHeader().getHeaderInfo("Accept-Encoding");
+
+    if (acceptEncoding.isNull())
+    {
+        return false;
+    }
+
+    // "gzip;q=0" explicitly refuses gzip
+    return acceptedContentEncodings(*acceptEncoding.data()).contains(ContentEncoding::GZip);
+}
+
+void TimingMiddleware::report(HttpRequest &request, const HttpResponse &response)
+{
+#ifndef NO_LOG
+    sLog() << "handled" << request.getHeader().getPath() << "in" << response.elapsedNanoseconds() / 1000 << "us";
+#else
+    Q_UNUSED(request)
+    Q_UNUSED(response)
+#endif
+}
@@ -0,0 +1,118 @@
+#ifndef MIDDLEWARE_H
+#define MIDDLEWARE_H
+
+#include <type_traits>
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+/*! \brief MiddlewareChain composes middlewares around a handler at compile time
+ *
+ * A middleware is a type with a static function
+ * \code
+ * template<typename Next>
+ * static void handle(HttpRequest &request, HttpResponse &response, Next &&next);
+ * \endcode
+ * that does its work and calls next(request, response) to continue down the chain, or returns without calling it
+ * to short-circuit the request. Chains are attached to a route with WebApp::addGet<&App::handler, Middlewares...>(),
+ * or to every route of a WebApp by declaring "typedef MiddlewareChain<...> Middlewares;" in the WebApp class.
+ * Every hop is a template instantiation, so the compiler can inline the whole chain into the route's trampoline.
+ */
+template<typename... Middlewares>
+struct MiddlewareChain;
+
+template<>
+struct MiddlewareChain<>
+{
+    template<typename... More>
+    using Append = MiddlewareChain<More...>;
+
+    template<typename Handler>
+    static inline void run(HttpRequest &request, HttpResponse &response, Handler &&handler)
+    {
+        handler(request, response);
+    }
+};
+
+template<typename First, typename... Rest>
+struct MiddlewareChain<First, Rest...>
+{
+    template<typename... More>
+    using Append = MiddlewareChain<First, Rest..., More...>;
+
+    template<typename Handler>
+    static inline void run(HttpRequest &request, HttpResponse &response, Handler &&handler)
+    {
+        First::handle(request, response, [&handler](HttpRequest &request, HttpResponse &response){
+            MiddlewareChain<Rest...>::run(request, response, handler);
+        });
+    }
+};
+
+//! \brief WebAppMiddlewares looks up the chain a WebApp declares for all its routes, empty if it declares none
+template<typename App, typename = void>
+struct WebAppMiddlewares
+{
+    typedef MiddlewareChain<> Chain;
+};
+
+template<typename App>
+struct WebAppMiddlewares<App, std::void_t<typename App::Middlewares>>
+{
+    typedef typename App::Middlewares Chain;
+};
+
+/*!
+ * \brief CompressionMiddleware negotiates gzip with the client
+ *
+ * If the request accepts gzip, compressible bodies are gzipped by HttpResponse::finish(). Handlers serving
+ * precompressed content can check HttpResponse::isGZipAccepted() instead of parsing Accept-Encoding.
+ */
+struct CompressionMiddleware
+{
+    template<typename Next>
+    static void handle(HttpRequest &request, HttpResponse &response, Next &&next)
+    {
+        response.setGZipAccepted(acceptsGZip(request));
+        next(request, response);
+    }
+
+    static bool acceptsGZip(HttpRequest &request);
+};
+
+/*!
+ * \brief ConditionalGetMiddleware answers 304 Not Modified when If-None-Match matches the response's ETag
+ *
+ * The handler still runs, the saving is on the wire. The ETag is the one set by the handler, or a hash of the body,
+ * see contentETag(). Handlers that know a cheaper validator, e.g. a version number, should set it: the body is then
+ * never hashed, and a request without If-None-Match is answered as is.
+ */
+struct ConditionalGetMiddleware
+{
+    template<typename Next>
+    static void handle(HttpRequest &request, HttpResponse &response, Next &&next)
+    {
+        QWeakPointer<QString> ifNoneMatch = request.getHeader().getHeaderInfo("If-None-Match");
+        response.setConditionalGet(ifNoneMatch.isNull() ? QString() : *ifNoneMatch.data());
+        next(request, response);
+    }
+};
+
+/*!
+ * \brief TimingMiddleware measures the time spent in the rest of the chain
+ *
+ * The duration is sent in a Server-Timing header and logged.
+ */
+struct TimingMiddleware
+{
+    template<typename Next>
+    static void handle(HttpRequest &request, HttpResponse &response, Next &&next)
+    {
+        response.startTiming();
+        next(request, response);
+        report(request, response);
+    }
+
+    static void report(HttpRequest &request, const HttpResponse &response);
+};
+
+#endif // MIDDLEWARE_H
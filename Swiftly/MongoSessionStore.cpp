@@ -0,0 +1,136 @@
+#include "MongoSessionStore.h"
+#include <bsoncxx/builder/stream/document.hpp>
+#include <mongocxx/client.hpp>
+#include <mongocxx/stdx.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include "MongodbManager.h"
+#include "SessionTouchBuffer.h"
+
+MongoSessionStore::MongoSessionStore()
+    :SessionStore()
+{
+
+}
+
+void MongoSessionStore::initialize()
+{
+    auto client = MongodbManager::getSingleton().getClient();
+
+    mongocxx::database swiftlyDb = (*client)["Swiftly"];
+    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+
+    bsoncxx::builder::stream::document sessionIdIndexBuilder;
+    mongocxx::options::index sessionIdOptions{};
+    sessionIdIndexBuilder << "session_id" << 1;
+    sessionIdOptions.unique(true);
+    sessionCollection.create_index(sessionIdIndexBuilder.view(), sessionIdOptions);
+}
+
+void MongoSessionStore::shutdown()
+{
+    SessionTouchBuffer::getSingleton().shutdown();
+}
+
+bool MongoSessionStore::insert(const QByteArray &sessionId, const Session &session)
+{
+    auto client = MongodbManager::getSingleton().getClient();
+
+    mongocxx::database swiftlyDb = (*client)["Swiftly"];
+    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+
+    auto builder = bsoncxx::builder::stream::document{};
+    bsoncxx::document::value sessionDocumentValue = builder
+      << "email" << session.m_email.toStdString().c_str()
+      << "session_id" << sessionId.toStdString().c_str()
+      << "time" << static_cast<std::int64_t>(session.m_time)
+      << "user_id" << session.m_userId.toStdString().c_str()
+      << bsoncxx::builder::stream::finalize;
+
+    try
+    {
+        mongocxx::stdx::optional<mongocxx::result::insert_one> result =
+        sessionCollection.insert_one(sessionDocumentValue.view());
+
+        if (result)
+        {
+            return true;
+        }
+        else
+        {
+            //errorMessage = "Unknown issue when generate sessionId";
+            return false;
+        }
+    }
+    catch(const mongocxx::bulk_write_exception &e)
+    {
+        if (e.code().value() == 11000)
+        {
+            //qDebug() << "mongo error: duplicated email:" << e.what();
+            //errorMessage = "Duplicated sessionId exists" % QString::fromLatin1(e.what());
+        }
+        else
+        {
+            //qDebug() << "unknown mongo error:" << e.code().value() << e.what();
+            //errorMessage = "Database error:" % QString::fromLatin1(e.what());
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool MongoSessionStore::find(const QByteArray &sessionId, Session &session)
+{
+    auto client = MongodbManager::getSingleton().getClient();
+
+    mongocxx::database swiftlyDb = (*client)["Swiftly"];
+    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+
+    mongocxx::stdx::optional<bsoncxx::document::value> maybe_result =
+           sessionCollection.find_one(bsoncxx::builder::stream::document{}
+                                   << "session_id" << QString::fromLatin1(sessionId).toStdString().c_str() << bsoncxx::builder::stream::finalize);
+
+    if(maybe_result)
+    {
+        bsoncxx::document::element timeElement = (*maybe_result).view()["time"];
+        bsoncxx::document::element emailElement = (*maybe_result).view()["email"];
+        bsoncxx::document::element userIdElement = (*maybe_result).view()["user_id"];
+
+        session.m_time = timeElement.get_int64().value;
+        session.m_email = QString::fromStdString(emailElement.get_utf8().value.to_string());
+        session.m_userId = QString::fromStdString(userIdElement.get_utf8().value.to_string());
+
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool MongoSessionStore::remove(const QByteArray &sessionId)
+{
+    auto client = MongodbManager::getSingleton().getClient();
+
+    mongocxx::database swiftlyDb = (*client)["Swiftly"];
+    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+
+    mongocxx::stdx::optional<mongocxx::result::delete_result> maybe_result =
+           sessionCollection.delete_one(bsoncxx::builder::stream::document{}
+                                   << "session_id" << QString::fromLatin1(sessionId).toStdString().c_str() << bsoncxx::builder::stream::finalize);
+
+    if(maybe_result)
+    {
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+void MongoSessionStore::touch(const QByteArray &sessionId, qint64 time)
+{
+    // written with the other touches of the next flush
+    SessionTouchBuffer::getSingleton().touch(sessionId, time);
+}
@@ -0,0 +1,30 @@
+#ifndef MONGOSESSIONSTORE_H
+#define MONGOSESSIONSTORE_H
+
+#include "SessionStore.h"
+
+/*! \brief MongoSessionStore keeps sessions in the Session collection of the Swiftly database
+ *
+ * Every call is a round trip, except touch(), which SessionTouchBuffer writes in batches.
+ */
+class MongoSessionStore : public SessionStore
+{
+public:
+    MongoSessionStore();
+
+    //! \brief initialize creates the unique index on session_id
+    void initialize() override;
+    //! \brief shutdown writes the touches SessionTouchBuffer still holds
+    void shutdown() override;
+    bool insert(const QByteArray &sessionId, const Session &session) override;
+    bool find(const QByteArray &sessionId, Session &session) override;
+    bool remove(const QByteArray &sessionId) override;
+    void touch(const QByteArray &sessionId, qint64 time) override;
+
+    bool isRemote() const override
+    {
+        return true;
+    }
+};
+
+#endif // MONGOSESSIONSTORE_H
@@ -5,11 +5,35 @@
 PathTree::PathTree(QObject *parent)
     :QObject(parent),
       m_root(new PathTreeNode("")),
-      m_emptyFunc()
+      m_emptyHandler(),
+      m_functionHandlers()
 {
 }
 
-bool PathTree::registerAPath(const QString &path, const std::function<void(HttpRequest &, HttpResponse &)> &in,enum PathTreeNode::HttpVerb verb)
+void PathTree::invokeFunction(void *function, HttpRequest &request, HttpResponse &response)
+{
+    (*static_cast<std::function<void(HttpRequest &, HttpResponse &)>*>(function))(request, response);
+}
+
+bool PathTree::registerAPath(const QString &path, const std::function<void(HttpRequest &, HttpResponse &)> &in, enum PathTreeNode::HttpVerb verb)
+{
+    if (!in)
+    {
+        return false;
+    }
+
+    QSharedPointer<std::function<void(HttpRequest &, HttpResponse &)>> function(new std::function<void(HttpRequest &, HttpResponse &)>(in));
+
+    if (registerAPath(path, TaskHandler(function.data(), &PathTree::invokeFunction), verb))
+    {
+        m_functionHandlers.push_back(function);
+        return true;
+    }
+
+    return false;
+}
+
+bool PathTree::registerAPath(const QString &path, const TaskHandler &in,enum PathTreeNode::HttpVerb verb)
 {
     /*qDebug()<<"Register a Handler:";
     qDebug()<<"Path:"<<path;
@@ -85,7 +109,7 @@ bool PathTree::registerAPath(const QString &path, const std::function<void(HttpR
     }
 }
 
-const std::function<void(HttpRequest &, HttpResponse &)> & PathTree::getTaskHandlerByPath(const QString &path,enum PathTreeNode::HttpVerb type)
+const TaskHandler & PathTree::getTaskHandlerByPath(const QString &path,enum PathTreeNode::HttpVerb type) const
 {
     if(!path.isEmpty() && path.at(0)=='/')
     {
@@ -105,7 +129,7 @@ const std::function<void(HttpRequest &, HttpResponse &)> & PathTree::getTaskHand
             int posBegin=1;
             int posEnd=1;
 
-            QWeakPointer<PathTreeNode> currentPathTreeNode = m_root.toWeakRef();
+            const PathTreeNode *currentPathTreeNode = m_root.data();
 
             for(posEnd=1;posEnd<path.count();++posEnd)
             {
@@ -118,12 +142,14 @@ const std::function<void(HttpRequest &, HttpResponse &)> & PathTree::getTaskHand
 
                     if (pathName == "." || pathName == "..")
                     {
-                        return m_emptyFunc;
+                        return m_emptyHandler;
                     }
 
-                    if(currentPathTreeNode.data()->hasChild(pathName))
+                    const PathTreeNode *child = currentPathTreeNode->findChild(pathName);
+
+                    if(child)
                     {
-                        currentPathTreeNode=currentPathTreeNode.data()->getChild(pathName);
+                        currentPathTreeNode = child;
                         posBegin = posEnd = posEnd + 1;
                     }
                     else
@@ -135,16 +161,16 @@ const std::function<void(HttpRequest &, HttpResponse &)> & PathTree::getTaskHand
 
             if(type==PathTreeNode::GET)
             {
-                return currentPathTreeNode.data()->getHandler();
+                return currentPathTreeNode->getHandler();
             }
             else
             {
-                return currentPathTreeNode.data()->postHandler();
+                return currentPathTreeNode->postHandler();
             }
         }
     }
     else
     {
-        return m_emptyFunc;
+        return m_emptyHandler;
     }
 }
@@ -2,6 +2,7 @@
 #define PATHTREE_H
 
 #include <QObject>
+#include <QVector>
 #include "PathTreeNode.h"
 
 /*! \brief PathTree represents a tree strcture that cat route a request to its handler
@@ -16,7 +17,11 @@ class PathTree : public QObject
 
     //! the root of the route path tree
     QSharedPointer<PathTreeNode> m_root;
-    std::function<void(HttpRequest &, HttpResponse &)> m_emptyFunc;
+    TaskHandler m_emptyHandler;
+    //! owns the std::function handlers, the tree nodes only point to them
+    QVector<QSharedPointer<std::function<void(HttpRequest &, HttpResponse &)>>> m_functionHandlers;
+
+    static void invokeFunction(void *function, HttpRequest &request, HttpResponse &response);
 public:
 
     /*!
@@ -28,8 +33,7 @@ public:
     /*!
      * \brief registerAPath parse a path and merge it into the current route tree
      * \param[in] path is the route path
-     * \param[in] object is the WebApp that will handle the requests of this path
-     * \param[in] methodName the name of the function of the WebApp that should handle this request
+     * \param[in] in the handler, normally a WebApp member function bound with TaskHandler::fromMethod()
      * \param[in] verb the verb of the handler response to, such as, GET or POST
      * \return return true on sucess.
      *
@@ -41,6 +45,14 @@ public:
      * There can't be 2 WebApps that share the same route. If a WebApp has been registered to handle a route, another registration
      * using the same path will fail.
      */
+    bool registerAPath(const QString &path, const TaskHandler &in, enum PathTreeNode::HttpVerb verb);
+
+    /*!
+     * \brief registerAPath overload for arbitrary callables
+     *
+     * The function is kept by the tree and invoked through one extra indirection. Prefer the TaskHandler
+     * overload for member functions.
+     */
     bool registerAPath(const QString &path, const std::function<void(HttpRequest &, HttpResponse &)> &in, enum PathTreeNode::HttpVerb verb);
 
     /*!
@@ -49,9 +61,11 @@ public:
      * \param[in] taskHandleType the type of the handler, such as GET or POST
      * \return return the handler upon finish.
      *
+     * This function is read only, once all paths are registered, the tree can be shared by all workers.
+     *
      * \todo HttpVerb should be a strong type enum
      */
-    const std::function<void(HttpRequest &, HttpResponse &)> & getTaskHandlerByPath(const QString &path, enum PathTreeNode::HttpVerb verb);
+    const TaskHandler & getTaskHandlerByPath(const QString &path, enum PathTreeNode::HttpVerb verb) const;
 };
 
 #endif // PATHTREE_H
@@ -40,7 +40,7 @@ bool PathTreeNode::hasChild(const QString &childPathName) const
     return m_children.contains(childPathName);
 }
 
-bool PathTreeNode::setGetHandler(const std::function<void (HttpRequest &, HttpResponse &)> &in)
+bool PathTreeNode::setGetHandler(const TaskHandler &in)
 {
     if(m_getTaskHandler)
     {
@@ -53,7 +53,7 @@ bool PathTreeNode::setGetHandler(const std::function<void (HttpRequest &, HttpRe
     }
 }
 
-bool PathTreeNode::setPostHandler(const std::function<void (HttpRequest &, HttpResponse &)> &in)
+bool PathTreeNode::setPostHandler(const TaskHandler &in)
 {
     if(m_postTaskHandler)
     {
@@ -5,6 +5,7 @@
 #include <functional>
 #include "HttpRequest.h"
 #include "HttpResponse.h"
+#include "TaskHandler.h"
 
 class PathTreeNode:public QObject
 {
@@ -12,8 +13,8 @@ class PathTreeNode:public QObject
 
     QString m_pathName;
     QHash<QString, QSharedPointer<PathTreeNode>> m_children;
-    std::function<void(HttpRequest &, HttpResponse &)> m_getTaskHandler;
-    std::function<void(HttpRequest &, HttpResponse &)> m_postTaskHandler;
+    TaskHandler m_getTaskHandler;
+    TaskHandler m_postTaskHandler;
     void operator=(const PathTreeNode &in);
     PathTreeNode(const PathTreeNode &in);
 public:
@@ -38,16 +39,24 @@ public:
         return m_children[childePathName];
     }
 
-    bool setGetHandler(const std::function<void (HttpRequest &, HttpResponse &)> &in);
+    // read only lookup used while routing, it doesn't touch the reference counts
+    // so that workers sharing one tree don't contend on the same nodes.
+    const PathTreeNode * findChild(const QString &childPathName) const
+    {
+        QHash<QString, QSharedPointer<PathTreeNode>>::const_iterator iter = m_children.constFind(childPathName);
+        return iter == m_children.constEnd() ? nullptr : iter.value().data();
+    }
+
+    bool setGetHandler(const TaskHandler &in);
 
-    bool setPostHandler(const std::function<void (HttpRequest &, HttpResponse &)> &in);
+    bool setPostHandler(const TaskHandler &in);
 
-    const std::function<void(HttpRequest &, HttpResponse &)> & getHandler() const
+    const TaskHandler & getHandler() const
     {
         return m_getTaskHandler;
     }
 
-    const std::function<void(HttpRequest &, HttpResponse &)> & postHandler() const
+    const TaskHandler & postHandler() const
     {
         return m_postTaskHandler;
     }
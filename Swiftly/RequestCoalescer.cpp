@@ -0,0 +1,146 @@
+#include "RequestCoalescer.h"
+#include "TcpSocket.h"
+#include "Worker.h"
+#include "SettingsManager.h"
+#include <QMetaObject>
+#include <QTimer>
+#include <QStringBuilder>
+
+RequestCoalescer::RequestCoalescer()
+    :m_mutex(),
+      m_flights(),
+      m_maximumWait(5000)
+{
+    m_maximumWait = SettingsManager::getSingleton().get("RequestCoalescer/maximumWaitMilliseconds", 5000).toInt();
+}
+
+QString RequestCoalescer::makeKey(HttpRequest &request, const QStringList &varyHeaders)
+{
+    QString key = request.getHeader().getPath() % '?' % request.getHeader().getQueryString();
+
+    for(QStringList::ConstIterator iter = varyHeaders.constBegin(); iter != varyHeaders.constEnd(); ++iter)
+    {
+        QWeakPointer<QString> value = request.getHeader().getHeaderInfo(*iter);
+        key = key % '\n' % *iter % ':' % (value.isNull() ? QString() : *value.data());
+    }
+
+    return key;
+}
+
+bool RequestCoalescer::join(const QString &key, TcpSocket *socket)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QHash<QString, QSharedPointer<Flight>>::iterator iter = m_flights.find(key);
+
+    if (iter == m_flights.end())
+    {
+        m_flights.insert(key, QSharedPointer<Flight>(new Flight()));
+        return true;
+    }
+
+    // called on the waiter's own thread, so reading its parent is safe here
+    Waiter waiter;
+    waiter.m_worker = socket->parent();
+    waiter.m_socket = socket;
+    iter.value()->m_waiters.push_back(waiter);
+
+    // a slow leader doesn't hold the waiters for longer than this, the timer goes with the socket
+    QTimer::singleShot(m_maximumWait, socket, [key, socket]() {
+        RequestCoalescer::getSingleton().expire(key, socket);
+    });
+
+    return false;
+}
+
+void RequestCoalescer::expire(const QString &key, TcpSocket *socket)
+{
+    Waiter waiter;
+    bool found = false;
+
+    m_mutex.lock();
+    QHash<QString, QSharedPointer<Flight>>::iterator iter = m_flights.find(key);
+    if (iter != m_flights.end())
+    {
+        QVector<Waiter> &waiters = iter.value()->m_waiters;
+
+        for(int i = 0; i < waiters.size(); ++i)
+        {
+            if (waiters[i].m_socket == socket)
+            {
+                waiter = waiters.takeAt(i);
+                found = true;
+                break;
+            }
+        }
+    }
+    m_mutex.unlock();
+
+    if (found)
+    {
+        release(waiter);
+    }
+}
+
+void RequestCoalescer::complete(const QString &key, const HttpResponse &response)
+{
+    QSharedPointer<Flight> flight;
+
+    m_mutex.lock();
+    flight = m_flights.take(key);
+    m_mutex.unlock();
+
+    if (flight.isNull() || flight->m_waiters.isEmpty())
+    {
+        return;
+    }
+
+    const QByteArray &serialized = response.getCaptured();
+
+    // cookies belong to the leader's client, and a mapped body isn't captured, the waiters run the handler instead
+    bool replayable = !response.hasCookies() && !serialized.isEmpty();
+
+    for(int i = 0; i < flight->m_waiters.size(); ++i)
+    {
+        if (replayable)
+        {
+            deliver(flight->m_waiters[i], serialized);
+        }
+        else
+        {
+            release(flight->m_waiters[i]);
+        }
+    }
+}
+
+void RequestCoalescer::deliver(const Waiter &waiter, const QByteArray &serialized)
+{
+    QPointer<TcpSocket> socket = waiter.m_socket;
+
+    // the socket may only be touched from its worker's thread, where it can't be deleted under our feet
+    QMetaObject::invokeMethod(waiter.m_worker, [socket, serialized]() {
+        if (socket.isNull())
+        {
+            return;
+        }
+
+        socket->getResponse().finishWithSerialized(serialized);
+        socket->waitForBytesWritten();
+        socket->close();
+    }, Qt::QueuedConnection);
+}
+
+void RequestCoalescer::release(const Waiter &waiter)
+{
+    QPointer<TcpSocket> socket = waiter.m_socket;
+    Worker *worker = static_cast<Worker *>(waiter.m_worker);
+
+    QMetaObject::invokeMethod(worker, [socket, worker]() {
+        if (socket.isNull())
+        {
+            return;
+        }
+
+        worker->resumeParked(socket.data());
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,136 @@
+#ifndef REQUESTCOALESCER_H
+#define REQUESTCOALESCER_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QPointer>
+#include <QSharedPointer>
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+class TcpSocket;
+
+/*! \brief RequestCoalescer lets identical concurrent requests share one handler run
+ *
+ * The first request for a key becomes the leader of a flight and runs the handler. Identical requests arriving
+ * meanwhile, on any worker, join the flight as waiters: their sockets are parked, their workers go back to their
+ * event loops, and once the leader is done the serialized response is posted to each waiter's thread and written there.
+ *
+ * A response that can't be replayed, one setting cookies or sending a mapped file, isn't shared: the waiters are
+ * given back to their workers and run the handler themselves, see Worker::resumeParked(). So is a waiter still
+ * waiting after "RequestCoalescer/maximumWaitMilliseconds" (5000 by default).
+ */
+class RequestCoalescer
+{
+    class Waiter
+    {
+    public:
+        //! the worker owning the socket, it lives as long as the server, unlike the socket
+        QObject *m_worker;
+        QPointer<TcpSocket> m_socket;
+    };
+
+    class Flight
+    {
+    public:
+        QVector<Waiter> m_waiters;
+    };
+
+    QMutex m_mutex;
+    QHash<QString, QSharedPointer<Flight>> m_flights;
+    int m_maximumWait;
+
+    RequestCoalescer();
+
+public:
+    static RequestCoalescer &getSingleton()
+    {
+        static RequestCoalescer obj;
+        return obj;
+    }
+
+    /*!
+     * \brief makeKey builds the key of a request from its path, query string and the headers the response varies on
+     * \param[in] request the request
+     * \param[in] varyHeaders the names of the headers that become part of the key
+     */
+    static QString makeKey(HttpRequest &request, const QStringList &varyHeaders);
+
+    /*!
+     * \brief join joins the flight of a key, or starts it
+     * \param[in] key the request key
+     * \param[in] socket the socket of the request, parked if it becomes a waiter
+     * \return true if the caller is the leader and must call complete() when done
+     */
+    bool join(const QString &key, TcpSocket *socket);
+
+    /*!
+     * \brief complete ends the flight of a key and fans the leader's response out to the waiters
+     * \param[in] key the request key
+     * \param[in] response the leader's finished response, it must have been captured
+     */
+    void complete(const QString &key, const HttpResponse &response);
+
+private:
+    //! \brief expire gives a waiter back to its worker if it is still waiting, called on the waiter's thread
+    void expire(const QString &key, TcpSocket *socket);
+    static void deliver(const Waiter &waiter, const QByteArray &serialized);
+    static void release(const Waiter &waiter);
+};
+
+//! \brief CoalescePolicy is the default policy of CoalesceMiddleware
+struct CoalescePolicy
+{
+    //! request headers that change the response, requests only coalesce if these are equal
+    static QStringList varyHeaders()
+    {
+        // a conditional or range request may be answered 304 or 206, which only fits requests asking the same
+        return QStringList() << "Accept-Encoding" << "If-None-Match" << "If-Modified-Since" << "Range" << "If-Range";
+    }
+
+    //! only anonymous GET requests are coalesced, a logged in user's response may be personalized
+    static bool isCoalescable(HttpRequest &request)
+    {
+        return request.isCoalescable()
+                && request.getHeader().getHttpMethod() == HttpHeader::HttpMethod::HTTP_GET
+                && !request.getHeader().getCookie().contains("ssid");
+    }
+};
+
+/*!
+ * \brief CoalesceMiddleware runs a route's handler once for identical concurrent requests
+ *
+ * For routes that aren't cached, e.g. addGet<&MyApp::handleGet, CoalesceMiddleware<>>("/x"), a popular page costs one
+ * handler run at a time instead of one per worker. ResponseCacheMiddleware already coalesces its misses.
+ */
+template<typename Policy = CoalescePolicy>
+struct CoalesceMiddleware
+{
+    template<typename Next>
+    static void handle(HttpRequest &request, HttpResponse &response, Next &&next)
+    {
+        if (!Policy::isCoalescable(request) || !request.m_socket)
+        {
+            next(request, response);
+            return;
+        }
+
+        QString key = RequestCoalescer::makeKey(request, Policy::varyHeaders());
+
+        if (!RequestCoalescer::getSingleton().join(key, request.m_socket))
+        {
+            response.defer();
+            return;
+        }
+
+        response.setCaptureEnabled(true);
+        next(request, response);
+        response.finish();
+        RequestCoalescer::getSingleton().complete(key, response);
+    }
+};
+
+#endif // REQUESTCOALESCER_H
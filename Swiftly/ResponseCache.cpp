@@ -0,0 +1,137 @@
+#include "ResponseCache.h"
+#include "SettingsManager.h"
+#include <QDateTime>
+
+ResponseCache::ResponseCache()
+    :m_shards(),
+      m_shardBudget(0)
+{
+    qint64 budget = SettingsManager::getSingleton().get("ResponseCache/budgetMB", 32).toLongLong() * 1024 * 1024;
+    m_shardBudget = budget / m_shardCount;
+}
+
+QSharedPointer<ResponseCache::Entry> ResponseCache::lookup(const QString &key, State &state, bool &claimed)
+{
+    Shard &shard = shardFor(key);
+    QSharedPointer<Entry> entry;
+
+    shard.m_lock.lockForRead();
+    QHash<QString, QSharedPointer<Entry>>::const_iterator iter = shard.m_entries.constFind(key);
+    if (iter != shard.m_entries.constEnd())
+    {
+        entry = iter.value();
+    }
+    shard.m_lock.unlock();
+
+    if (entry.isNull())
+    {
+        state = State::Miss;
+        claimed = true;
+        return entry;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (now < entry->m_expiresAt)
+    {
+        state = State::Fresh;
+        claimed = false;
+    }
+    else
+    {
+        state = now < entry->m_staleUntil ? State::Stale : State::Miss;
+        claimed = entry->m_refreshing.testAndSetAcquire(0, 1);
+    }
+
+    return entry;
+}
+
+// the Server-Timing header TimingMiddleware adds describes the request that produced the response, not those served from the cache
+static QByteArray withoutServerTiming(const QByteArray &serialized)
+{
+    int headerEnd = serialized.indexOf("\r\n\r\n");
+    int start = serialized.indexOf("\r\nServer-Timing: ");
+
+    if (start == -1 || start >= headerEnd)
+    {
+        return serialized;
+    }
+
+    int end = serialized.indexOf("\r\n", start + 2);
+    QByteArray stripped(serialized);
+    stripped.remove(start, end - start);
+    return stripped;
+}
+
+void ResponseCache::complete(const QString &key, const HttpResponse &response, const QSharedPointer<Entry> &previous, int ttl, int staleWhileRevalidate)
+{
+    const QByteArray serialized = withoutServerTiming(response.getCaptured());
+
+    if (response.getStatusCode() != 200 || response.hasCookies() || serialized.isEmpty() || serialized.size() > m_shardBudget)
+    {
+        release(previous);
+        return;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QSharedPointer<Entry> entry(new Entry(serialized, now + ttl, now + ttl + staleWhileRevalidate));
+    Shard &shard = shardFor(key);
+
+    shard.m_lock.lockForWrite();
+    QHash<QString, QSharedPointer<Entry>>::iterator iter = shard.m_entries.find(key);
+    if (iter != shard.m_entries.end())
+    {
+        shard.m_bytes -= iter.value()->m_response.size();
+        shard.m_expiries.remove(iter.value()->m_expiresAt, key);
+        iter.value() = entry;
+    }
+    else
+    {
+        shard.m_entries.insert(key, entry);
+    }
+    shard.m_expiries.insert(entry->m_expiresAt, key);
+    shard.m_bytes += serialized.size();
+
+    if (shard.m_bytes > m_shardBudget)
+    {
+        evict(shard);
+    }
+    shard.m_lock.unlock();
+}
+
+void ResponseCache::release(const QSharedPointer<Entry> &previous)
+{
+    if (!previous.isNull())
+    {
+        previous->m_refreshing.storeRelease(0);
+    }
+}
+
+void ResponseCache::remove(const QString &key)
+{
+    Shard &shard = shardFor(key);
+
+    shard.m_lock.lockForWrite();
+    QHash<QString, QSharedPointer<Entry>>::iterator iter = shard.m_entries.find(key);
+    if (iter != shard.m_entries.end())
+    {
+        shard.m_bytes -= iter.value()->m_response.size();
+        shard.m_expiries.remove(iter.value()->m_expiresAt, key);
+        shard.m_entries.erase(iter);
+    }
+    shard.m_lock.unlock();
+}
+
+void ResponseCache::evict(Shard &shard)
+{
+    // the entries closest to expiry go first, those that can't be served anymore are among them
+    while (shard.m_bytes > m_shardBudget && !shard.m_expiries.isEmpty())
+    {
+        QMultiMap<qint64, QString>::iterator victim = shard.m_expiries.begin();
+        QHash<QString, QSharedPointer<Entry>>::iterator iter = shard.m_entries.find(victim.value());
+
+        shard.m_bytes -= iter.value()->m_response.size();
+        shard.m_entries.erase(iter);
+        shard.m_expiries.erase(victim);
+    }
+}
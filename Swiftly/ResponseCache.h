@@ -0,0 +1,251 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "RequestCoalescer.h"
+
+/*! \brief ResponseCache keeps fully serialized responses of idempotent GET handlers
+ *
+ * Entries are keyed by path, query string and the request headers a route varies on. The cache is shared by all
+ * workers, it is split into shards to keep lock contention low, and bounded by a byte budget read from the setting
+ * "ResponseCache/budgetMB". Routes opt in with ResponseCacheMiddleware.
+ */
+class ResponseCache
+{
+public:
+    class Entry
+    {
+    public:
+        const QByteArray m_response;
+        const qint64 m_expiresAt;
+        const qint64 m_staleUntil;
+        //! set by the one request that refreshes this entry once it has expired
+        QAtomicInt m_refreshing;
+
+        Entry(const QByteArray &response, qint64 expiresAt, qint64 staleUntil)
+            :m_response(response),
+              m_expiresAt(expiresAt),
+              m_staleUntil(staleUntil),
+              m_refreshing(0)
+        {}
+    };
+
+    enum class State
+    {
+        Miss,
+        Fresh,
+        Stale
+    };
+
+private:
+    class Shard
+    {
+    public:
+        QReadWriteLock m_lock;
+        QHash<QString, QSharedPointer<Entry>> m_entries;
+        // the keys by expiry time, so that eviction doesn't scan the entries
+        QMultiMap<qint64, QString> m_expiries;
+        qint64 m_bytes;
+
+        Shard()
+            :m_lock(),
+              m_entries(),
+              m_expiries(),
+              m_bytes(0)
+        {}
+    };
+
+    static const int m_shardCount = 16;
+    Shard m_shards[m_shardCount];
+    qint64 m_shardBudget;
+
+    ResponseCache();
+
+    Shard & shardFor(const QString &key)
+    {
+        return m_shards[qHash(key) % m_shardCount];
+    }
+
+    void evict(Shard &shard);
+
+public:
+    static ResponseCache &getSingleton()
+    {
+        static ResponseCache obj;
+        return obj;
+    }
+
+    static QString makeKey(HttpRequest &request, const QStringList &varyHeaders)
+    {
+        return RequestCoalescer::makeKey(request, varyHeaders);
+    }
+
+    /*!
+     * \brief lookup finds the cached response of a key
+     * \param[in] key the cache key, see makeKey()
+     * \param[out] state Fresh within the ttl, Stale within the stale-while-revalidate window after it, Miss otherwise
+     * \param[out] claimed true if the caller is the one request that should recompute the response
+     * \return the entry, null if there is none
+     *
+     * Only one caller is given the claim on an expired entry, so only one worker recomputes it.
+     * When there is no entry at all every caller gets the claim, ResponseCacheMiddleware coalesces them.
+     */
+    QSharedPointer<Entry> lookup(const QString &key, State &state, bool &claimed);
+
+    /*!
+     * \brief complete stores the response a claimed request has produced
+     * \param[in] key the cache key
+     * \param[in] response the finished response, it must have been captured
+     * \param[in] previous the entry that was being refreshed, if any
+     * \param[in] ttl milliseconds the response is fresh
+     * \param[in] staleWhileRevalidate milliseconds after the ttl the response may still be served stale
+     *
+     * Only successful responses that don't set cookies are stored, without their Server-Timing header, which only
+     * describes the request that produced them. Otherwise the claim on the previous entry is released, so that another
+     * request can try again.
+     */
+    void complete(const QString &key, const HttpResponse &response, const QSharedPointer<Entry> &previous, int ttl, int staleWhileRevalidate);
+
+    //! \brief release gives up a claim without storing anything, e.g. when the response was deferred
+    void release(const QSharedPointer<Entry> &previous);
+
+    void remove(const QString &key);
+};
+
+//! \brief ResponseCachePolicy is the default policy of ResponseCacheMiddleware, derive from it to change a part of it
+struct ResponseCachePolicy
+{
+    //! milliseconds a response is served from the cache without running the handler
+    static constexpr int ttl = 1000;
+    //! milliseconds after the ttl during which the stale response is served while a single request refreshes it
+    static constexpr int staleWhileRevalidate = 10000;
+
+    //! request headers that change the response, they become part of the cache key
+    static QStringList varyHeaders()
+    {
+        return QStringList() << "Accept-Encoding";
+    }
+
+    //! only anonymous requests are cached, logged in users may see personalized content
+    static bool isCacheable(HttpRequest &request)
+    {
+        return request.getHeader().getHttpMethod() == HttpHeader::HttpMethod::HTTP_GET
+                && !request.getHeader().getCookie().contains("ssid");
+    }
+};
+
+/*!
+ * \brief ResponseCacheMiddleware serves a route from ResponseCache
+ *
+ * A fresh hit writes the cached bytes and skips the rest of the chain. Within the stale-while-revalidate window,
+ * the stale bytes are sent right away, and the single request holding the claim then runs the handler on a detached
+ * response to refresh the entry. Its client has its response by then, but the worker, and the connection, are busy
+ * until the refresh is done, so one request pays for it.
+ *
+ * On a miss, with no entry or one past the window, identical requests join a RequestCoalescer flight: one of them
+ * runs the handler and the others are answered with its response. The flight key also varies on the headers of
+ * CoalescePolicy, so a 304 or 206 is only shared with requests asking for it.
+ * Usage: addGet<&MyApp::handlePageGet, ResponseCacheMiddleware<MyPolicy>>("/page").
+ */
+template<typename Policy = ResponseCachePolicy>
+struct ResponseCacheMiddleware
+{
+    template<typename Next>
+    static void handle(HttpRequest &request, HttpResponse &response, Next &&next)
+    {
+        if (!Policy::isCacheable(request))
+        {
+            next(request, response);
+            return;
+        }
+
+        QString key = ResponseCache::makeKey(request, Policy::varyHeaders());
+        ResponseCache::State state = ResponseCache::State::Miss;
+        bool claimed = false;
+        QSharedPointer<ResponseCache::Entry> entry = ResponseCache::getSingleton().lookup(key, state, claimed);
+
+        if (state == ResponseCache::State::Fresh || (state == ResponseCache::State::Stale && !claimed))
+        {
+            response.finishWithSerialized(entry->m_response);
+            return;
+        }
+
+        if (state == ResponseCache::State::Stale)
+        {
+            HttpResponse revalidation(response);
+            revalidation.setSocket(nullptr);
+            revalidation.setCaptureEnabled(true);
+
+            response.finishWithSerialized(entry->m_response);
+
+            next(request, revalidation);
+
+            if (revalidation.isDeferred())
+            {
+                ResponseCache::getSingleton().release(entry);
+                return;
+            }
+
+            revalidation.finish();
+            ResponseCache::getSingleton().complete(key, revalidation, entry, Policy::ttl, Policy::staleWhileRevalidate);
+            return;
+        }
+
+        QString flightKey;
+
+        if (request.m_socket && CoalescePolicy::isCoalescable(request))
+        {
+            flightKey = QLatin1String("ResponseCache\n") + RequestCoalescer::makeKey(request, CoalescePolicy::varyHeaders());
+
+            if (!RequestCoalescer::getSingleton().join(flightKey, request.m_socket))
+            {
+                if (claimed)
+                {
+                    ResponseCache::getSingleton().release(entry);
+                }
+                response.defer();
+                return;
+            }
+        }
+
+        response.setCaptureEnabled(true);
+        next(request, response);
+
+        // deferred further down the chain, its response is written later and isn't ours to cache
+        if (response.isDeferred())
+        {
+            if (claimed)
+            {
+                ResponseCache::getSingleton().release(entry);
+            }
+            if (!flightKey.isEmpty())
+            {
+                RequestCoalescer::getSingleton().complete(flightKey, response);
+            }
+            return;
+        }
+
+        response.finish();
+
+        if (claimed)
+        {
+            ResponseCache::getSingleton().complete(key, response, entry, Policy::ttl, Policy::staleWhileRevalidate);
+        }
+
+        if (!flightKey.isEmpty())
+        {
+            RequestCoalescer::getSingleton().complete(flightKey, response);
+        }
+    }
+};
+
+#endif // RESPONSECACHE_H
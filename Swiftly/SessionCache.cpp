@@ -0,0 +1,130 @@
+#include "SessionCache.h"
+#include "SettingsManager.h"
+#include <QDateTime>
+
+SessionCache::SessionCache()
+    :m_shards(),
+      m_ttlInMilliseconds(0),
+      m_shardCapacity(0)
+{
+    m_ttlInMilliseconds = SettingsManager::getSingleton().get("SessionCache/ttlSeconds", 60).toLongLong() * 1000;
+    m_shardCapacity = qMax(SettingsManager::getSingleton().get("SessionCache/maximumEntries", 100000).toInt() / m_shardCount, 1);
+}
+
+bool SessionCache::find(const QByteArray &sessionId, Session &session)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
+    Shard &shard = shardFor(sessionId);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool found = false;
+
+    shard.m_lock.lockForRead();
+    QHash<QByteArray, Entry>::const_iterator iter = shard.m_entries.constFind(sessionId);
+    if (iter != shard.m_entries.constEnd() && now < iter->m_cachedUntil && now < iter->m_session.m_expiresAt)
+    {
+        session = iter->m_session;
+        found = true;
+    }
+    shard.m_lock.unlock();
+
+    if (found)
+    {
+        shard.m_hits.fetchAndAddRelaxed(1);
+    }
+    else
+    {
+        shard.m_misses.fetchAndAddRelaxed(1);
+    }
+
+    return found;
+}
+
+void SessionCache::insert(const QByteArray &sessionId, const Session &session)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    Shard &shard = shardFor(sessionId);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Entry entry;
+    entry.m_session = session;
+    entry.m_cachedUntil = now + m_ttlInMilliseconds;
+
+    shard.m_lock.lockForWrite();
+    shard.m_entries.insert(sessionId, entry);
+
+    if (shard.m_entries.size() > m_shardCapacity)
+    {
+        evict(shard, now);
+    }
+    shard.m_lock.unlock();
+}
+
+void SessionCache::remove(const QByteArray &sessionId)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    Shard &shard = shardFor(sessionId);
+
+    shard.m_lock.lockForWrite();
+    shard.m_entries.remove(sessionId);
+    shard.m_lock.unlock();
+}
+
+void SessionCache::evict(Shard &shard, qint64 now)
+{
+    int size = shard.m_entries.size();
+
+    // first drop what can't be served anymore
+    for(QHash<QByteArray, Entry>::iterator iter = shard.m_entries.begin(); iter != shard.m_entries.end();)
+    {
+        if (iter->m_cachedUntil <= now || iter->m_session.m_expiresAt <= now)
+        {
+            iter = shard.m_entries.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    // then an arbitrary eighth, hash order is as good as any for entries this short lived, and the next few inserts
+    // don't have to sweep again
+    int target = m_shardCapacity - m_shardCapacity / 8;
+
+    for(QHash<QByteArray, Entry>::iterator iter = shard.m_entries.begin(); shard.m_entries.size() > target && iter != shard.m_entries.end();)
+    {
+        iter = shard.m_entries.erase(iter);
+    }
+
+    shard.m_evictions.fetchAndAddRelaxed(static_cast<quint64>(size - shard.m_entries.size()));
+}
+
+SessionCache::Statistics SessionCache::statistics() const
+{
+    Statistics statistics;
+
+    for(int i = 0; i < m_shardCount; ++i)
+    {
+        const Shard &shard = m_shards[i];
+
+        shard.m_lock.lockForRead();
+        statistics.m_entries += shard.m_entries.size();
+        shard.m_lock.unlock();
+
+        statistics.m_hits += shard.m_hits.load();
+        statistics.m_misses += shard.m_misses.load();
+        statistics.m_evictions += shard.m_evictions.load();
+    }
+
+    return statistics;
+}
@@ -0,0 +1,120 @@
+#ifndef SESSIONCACHE_H
+#define SESSIONCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+
+/*! \brief SessionCache keeps recently validated sessions in memory, in front of the session collection
+ *
+ * A hit answers SessionManager::findSession() without a database round trip. Entries live for a short ttl, read from
+ * the setting "SessionCache/ttlSeconds" (60 by default, 0 disables the cache), and never past the expiry of the
+ * session itself. The cache is bounded by "SessionCache/maximumEntries". It is split into shards, each guarded by its
+ * own read write lock, hits only take a shared lock.
+ *
+ * A logout through this process removes the session right away. A session deleted by another process stays valid
+ * here for at most the ttl.
+ */
+class SessionCache
+{
+public:
+    class Session
+    {
+    public:
+        QString m_userId;
+        QString m_email;
+        // when the session times out, in ms since epoch
+        qint64 m_expiresAt;
+
+        Session()
+            :m_userId(),
+              m_email(),
+              m_expiresAt(0)
+        {}
+    };
+
+    //! \brief Statistics is a snapshot of the counters of all shards
+    class Statistics
+    {
+    public:
+        int m_entries;
+        quint64 m_hits;
+        quint64 m_misses;
+        quint64 m_evictions;
+
+        Statistics()
+            :m_entries(0),
+              m_hits(0),
+              m_misses(0),
+              m_evictions(0)
+        {}
+    };
+
+private:
+    class Entry
+    {
+    public:
+        Session m_session;
+        // when the entry must be read from the database again, in ms since epoch
+        qint64 m_cachedUntil;
+    };
+
+    // the counters are written by every lookup, each shard keeps them on its own cache lines
+    class alignas(64) Shard
+    {
+    public:
+        mutable QReadWriteLock m_lock;
+        QHash<QByteArray, Entry> m_entries;
+        QAtomicInteger<quint64> m_hits;
+        QAtomicInteger<quint64> m_misses;
+        QAtomicInteger<quint64> m_evictions;
+
+        Shard()
+            :m_lock(),
+              m_entries(),
+              m_hits(0),
+              m_misses(0),
+              m_evictions(0)
+        {}
+    };
+
+    static const int m_shardCount = 16;
+    Shard m_shards[m_shardCount];
+    qint64 m_ttlInMilliseconds;
+    int m_shardCapacity;
+
+    SessionCache();
+
+    Shard & shardFor(const QByteArray &sessionId)
+    {
+        return m_shards[qHash(sessionId) % m_shardCount];
+    }
+
+    void evict(Shard &shard, qint64 now);
+
+public:
+    static SessionCache &getSingleton()
+    {
+        static SessionCache obj;
+        return obj;
+    }
+
+    bool isEnabled() const
+    {
+        return m_ttlInMilliseconds > 0;
+    }
+
+    //! \brief find returns a session validated less than a ttl ago, false if it has to be read from the database
+    bool find(const QByteArray &sessionId, Session &session);
+
+    //! \brief insert remembers a session that has just been validated, or created
+    void insert(const QByteArray &sessionId, const Session &session);
+
+    void remove(const QByteArray &sessionId);
+
+    Statistics statistics() const;
+};
+
+#endif // SESSIONCACHE_H
@@ -1,83 +1,80 @@
 #include "SessionManager.h"
 #include <sodium.h>
-#include <bsoncxx/json.hpp>
-#include <bsoncxx/builder/stream/document.hpp>
-#include <mongocxx/instance.hpp>
-#include <mongocxx/client.hpp>
-#include <mongocxx/stdx.hpp>
-#include <mongocxx/uri.hpp>
-#include <mongocxx/bulk_write.hpp>
-#include <mongocxx/exception/bulk_write_exception.hpp>
 #include <QCryptographicHash>
 #include <QDateTime>
-#include "MongodbManager.h"
 #include "SettingsManager.h"
+#include "SessionCache.h"
+#include "SessionStore.h"
+#include "SessionTokenSigner.h"
 
 SessionManager::SessionManager()
+    :m_backend(backendFromSettings()),
+      m_store(nullptr),
+      m_timeoutThreshold(SettingsManager::getSingleton().get("sessionTimeoutThreshold", 3600*24*7).toLongLong()),
+      m_touchInterval(0)
 {
+    m_touchInterval = m_timeoutThreshold * SettingsManager::getSingleton().get("SessionManager/touchIntervalPercent", 1).toLongLong() / 100;
 
+    if (m_backend == Backend::Database)
+    {
+        m_store = &SessionStore::getSingleton();
+    }
+}
+
+SessionManager::Backend SessionManager::backendFromSettings()
+{
+    return SettingsManager::getSingleton().get("SessionManager/backend", "database").toString() == "token" ? Backend::SignedToken
+                                                                                                           : Backend::Database;
 }
 
 void SessionManager::init()
 {
-    auto client = MongodbManager::getSingleton().getClient();
+    if (backendFromSettings() == Backend::SignedToken)
+    {
+        return;
+    }
 
-    mongocxx::database swiftlyDb = (*client)["Swiftly"];
-    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+    SessionStore::getSingleton().initialize();
+}
 
-    bsoncxx::builder::stream::document sessionIdIndexBuilder;
-    mongocxx::options::index sessionIdOptions{};
-    sessionIdIndexBuilder << "session_id" << 1;
-    sessionIdOptions.unique(true);
-    sessionCollection.create_index(sessionIdIndexBuilder.view(), sessionIdOptions);
+void SessionManager::shutdown()
+{
+    if (backendFromSettings() == Backend::SignedToken)
+    {
+        return;
+    }
 
+    SessionStore::getSingleton().shutdown();
 }
 
 bool SessionManager::newSession(const QString &userId, const QString &email, QByteArray &sessionId)
 {
-    auto client = MongodbManager::getSingleton().getClient();
-
-    mongocxx::database swiftlyDb = (*client)["Swiftly"];
-    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+    if (m_backend == Backend::SignedToken)
+    {
+        sessionId = SessionTokenSigner::getSingleton().issue(userId, email, static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t()) + m_timeoutThreshold);
+        return !sessionId.isEmpty();
+    }
 
     generateSessionId(sessionId);
 
-    auto builder = bsoncxx::builder::stream::document{};
-    bsoncxx::document::value sessionDocumentValue = builder
-      << "email" << email.toStdString().c_str()
-      << "session_id" << sessionId.toStdString().c_str()
-      << "time" << static_cast<std::int64_t>( QDateTime::currentDateTimeUtc().toTime_t())
-      << "user_id" << userId.toStdString().c_str()
-      << bsoncxx::builder::stream::finalize;
+    SessionStore::Session session;
+    session.m_userId = userId;
+    session.m_email = email;
+    session.m_time = static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t());
 
-    try
+    if (!m_store->insert(sessionId, session))
     {
-        mongocxx::stdx::optional<mongocxx::result::insert_one> result =
-        sessionCollection.insert_one(sessionDocumentValue.view());
-
-        if (result)
-        {
-            return true;
-        }
-        else
-        {
-            //errorMessage = "Unknown issue when generate sessionId";
-            return false;
-        }
+        return false;
     }
-    catch(const mongocxx::bulk_write_exception &e)
+
+    if (m_store->isRemote())
     {
-        if (e.code().value() == 11000)
-        {
-            //qDebug() << "mongo error: duplicated email:" << e.what();
-            //errorMessage = "Duplicated sessionId exists" % QString::fromLatin1(e.what());
-        }
-        else
-        {
-            //qDebug() << "unknown mongo error:" << e.code().value() << e.what();
-            //errorMessage = "Database error:" % QString::fromLatin1(e.what());
-        }
-        return false;
+        // the client is about to come back with it
+        SessionCache::Session cached;
+        cached.m_userId = userId;
+        cached.m_email = email;
+        cached.m_expiresAt = (session.m_time + m_timeoutThreshold) * 1000;
+        SessionCache::getSingleton().insert(sessionId, cached);
     }
 
     return true;
@@ -85,78 +82,54 @@ bool SessionManager::newSession(const QString &userId, const QString &email, QBy
 
 bool SessionManager::findSession(const QByteArray &sessionId, QString &email)
 {
-    auto client = MongodbManager::getSingleton().getClient();
-
-    mongocxx::database swiftlyDb = (*client)["Swiftly"];
-    mongocxx::collection sessionCollection = swiftlyDb["Session"];
-
-    mongocxx::stdx::optional<bsoncxx::document::value> maybe_result =
-           sessionCollection.find_one(bsoncxx::builder::stream::document{}
-                                   << "session_id" << QString::fromLatin1(sessionId).toStdString().c_str() << bsoncxx::builder::stream::finalize);
-
-    if(maybe_result)
+    if (m_backend == Backend::SignedToken)
     {
-        //std::cout << bsoncxx::to_json(*maybe_result) << "\n";
-        //bsoncxx::document::element emailElement = (*maybe_result).view()["email"];
-        //email =  QString::fromStdString(emailElement.get_utf8().value.to_string());
-
-        bsoncxx::document::element timeElement = (*maybe_result).view()["time"];
-        std::int64_t time = timeElement.get_int64().value;
-
-        std::int64_t timeoutThreshold = SettingsManager::getSingleton().get("sessionTimeoutThreshold", 3600*24*7).toInt();
-
-        std::int64_t currentTime = static_cast<std::int64_t>( QDateTime::currentDateTimeUtc().toTime_t());
-
-        if ((currentTime - time) > timeoutThreshold)
-        {
-            //timeout
+        QString userId;
+        qint64 expiresAt = 0;
+        return SessionTokenSigner::getSingleton().verify(sessionId, userId, email, expiresAt);
+    }
 
-            mongocxx::stdx::optional<mongocxx::result::delete_result> result = sessionCollection.delete_one(bsoncxx::builder::stream::document{} << "session_id"
-                                                                                                            << QString::fromLatin1(sessionId).toStdString().c_str()
-                                                                                                            <<  bsoncxx::builder::stream::finalize);
+    SessionCache::Session cached;
 
-            if (result)
-            {
+    if (m_store->isRemote() && SessionCache::getSingleton().find(sessionId, cached))
+    {
+        email = cached.m_email;
+        return true;
+    }
 
-            }
+    SessionStore::Session session;
 
-            return false;
-        }
-        else
-        {
-            mongocxx::stdx::optional<mongocxx::result::update> result = sessionCollection.update_one(bsoncxx::builder::stream::document{} << "session_id"
-                                                                                                  << QString::fromLatin1(sessionId).toStdString().c_str()
-                                                                                                  << bsoncxx::builder::stream::finalize,
-                                      bsoncxx::builder::stream::document{} << "$set"
-                                      << bsoncxx::builder::stream::open_document
-                                      << "time" << currentTime
-                                      << bsoncxx::builder::stream::close_document
-                                      << bsoncxx::builder::stream::finalize);
+    if (!m_store->find(sessionId, session))
+    {
+        return false;
+    }
 
-            if (result)
-            {
-                return true;
-            }
-            else
-            {
-                return false;
-            }
-        }
+    qint64 currentTime = static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t());
 
-        bsoncxx::document::element emailElement = (*maybe_result).view()["email"];
+    if ((currentTime - session.m_time) > m_timeoutThreshold)
+    {
+        //timeout
+        m_store->remove(sessionId);
+        return false;
+    }
 
-        email = QString::fromStdString(emailElement.get_utf8().value.to_string());
+    if ((currentTime - session.m_time) > m_touchInterval)
+    {
+        m_store->touch(sessionId, currentTime);
+        session.m_time = currentTime;
+    }
 
+    email = session.m_email;
 
-        return true;
-    }
-    else
+    if (m_store->isRemote())
     {
-        //errorMessage = "No user registered with this email.";
-        return false;
+        cached.m_userId = session.m_userId;
+        cached.m_email = session.m_email;
+        // the time the store will time the session out from
+        cached.m_expiresAt = (session.m_time + m_timeoutThreshold) * 1000;
+        SessionCache::getSingleton().insert(sessionId, cached);
     }
 
-
     return true;
 }
 
@@ -173,24 +146,12 @@ void SessionManager::generateSessionId(QByteArray &sessionId)
 
 bool SessionManager::logoutSession(const QByteArray &sessionId)
 {
-    auto client = MongodbManager::getSingleton().getClient();
-
-    mongocxx::database swiftlyDb = (*client)["Swiftly"];
-    mongocxx::collection sessionCollection = swiftlyDb["Session"];
-
-    mongocxx::stdx::optional<mongocxx::result::delete_result> maybe_result =
-           sessionCollection.delete_one(bsoncxx::builder::stream::document{}
-                                   << "session_id" << QString::fromLatin1(sessionId).toStdString().c_str() << bsoncxx::builder::stream::finalize);
-
-    if(maybe_result)
+    if (m_backend == Backend::SignedToken)
     {
-        return true;
-    }
-    else
-    {
-        //errorMessage = "No user registered with this email.";
-        return false;
+        return SessionTokenSigner::getSingleton().revoke(sessionId);
     }
 
-    return true;
+    SessionCache::getSingleton().remove(sessionId);
+
+    return m_store->remove(sessionId);
 }
@@ -2,9 +2,40 @@
 #define SESSIONMANAGER_H
 
 #include <QByteArray>
+#include <QString>
 
+class SessionStore;
+
+/*! \brief SessionManager creates, validates and ends login sessions kept by a SessionStore
+ *
+ * Sessions validated against a remote store are remembered by SessionCache, a session used again within its ttl
+ * costs no database round trip. The "time" of a session is only moved forward once it lags by more than
+ * "SessionManager/touchIntervalPercent" (1 by default) of the timeout threshold, the Mongo store then writes it in a
+ * batch, see SessionTouchBuffer. A session may thus time out up to that share of the threshold early.
+ *
+ * With the setting "SessionManager/backend" set to "token", sessions are stateless instead: the session id is a
+ * token sealed by SessionTokenSigner, valid for the timeout threshold from login, and checked without any storage.
+ */
 class SessionManager
 {
+public:
+    enum class Backend
+    {
+        //! sessions are kept by the SessionStore of the settings, the default
+        Database,
+        //! sessions are sealed tokens, see SessionTokenSigner
+        SignedToken
+    };
+
+private:
+    Backend m_backend;
+    // the store of the settings, null with signed tokens
+    SessionStore *m_store;
+    // seconds of inactivity after which a session times out
+    qint64 m_timeoutThreshold;
+    // seconds a persisted "time" may lag behind before it is written again
+    qint64 m_touchInterval;
+
 public:
     SessionManager();
 
@@ -12,8 +43,19 @@ public:
     bool findSession(const QByteArray &sessionId, QString &email);
     bool logoutSession(const QByteArray &sessionId);
 
+    Backend backend() const
+    {
+        return m_backend;
+    }
+
+    //! \brief backendFromSettings reads "SessionManager/backend", "database" or "token"
+    static Backend backendFromSettings();
+
     static void init();
 
+    //! \brief shutdown writes what the session store has postponed, called by HttpServer once its workers have stopped
+    static void shutdown();
+
 private:
     void generateSessionId(QByteArray &sessionId);
 };
@@ -0,0 +1,44 @@
+#include "SessionStore.h"
+#include "MemorySessionStore.h"
+#include "MongoSessionStore.h"
+#include "TieredSessionStore.h"
+#include "SettingsManager.h"
+#include <QScopedPointer>
+#include <QDebug>
+
+SessionStore *SessionStore::create(const QString &name, qint64 timeoutThreshold)
+{
+    if (name == "mongodb")
+    {
+        return new MongoSessionStore();
+    }
+    else if (name == "memory")
+    {
+        return new MemorySessionStore(timeoutThreshold);
+    }
+    else if (name == "tiered")
+    {
+        return new TieredSessionStore(new MemorySessionStore(timeoutThreshold), new MongoSessionStore());
+    }
+
+    return nullptr;
+}
+
+SessionStore &SessionStore::getSingleton()
+{
+    static QScopedPointer<SessionStore> store([](){
+        QString name = SettingsManager::getSingleton().get("SessionManager/store", "mongodb").toString();
+        qint64 timeoutThreshold = SettingsManager::getSingleton().get("sessionTimeoutThreshold", 3600*24*7).toLongLong();
+        SessionStore *created = create(name, timeoutThreshold);
+
+        if (!created)
+        {
+            qDebug() << "unknown session store" << name << "sessions are kept in mongodb";
+            created = create("mongodb", timeoutThreshold);
+        }
+
+        return created;
+    }());
+
+    return *store;
+}
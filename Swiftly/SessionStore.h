@@ -0,0 +1,67 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QString>
+#include <QByteArray>
+
+/*! \brief SessionStore is where SessionManager keeps login sessions
+ *
+ * The store is chosen by the setting "SessionManager/store", see getSingleton():
+ * - "mongodb", the default, MongoSessionStore, the Session collection, shared by every process
+ * - "memory", MemorySessionStore, sessions of this process only, lost on restart, no database needed
+ * - "tiered", TieredSessionStore, a MemorySessionStore in front of the Session collection
+ *
+ * Implementations are safe to use from every worker at once.
+ */
+class SessionStore
+{
+public:
+    class Session
+    {
+    public:
+        QString m_userId;
+        QString m_email;
+        // when the session was last used, in seconds since epoch
+        qint64 m_time;
+
+        Session()
+            :m_userId(),
+              m_email(),
+              m_time(0)
+        {}
+    };
+
+    virtual ~SessionStore() {}
+
+    //! \brief initialize prepares the store once per process, e.g. creates indexes, see SessionManager::init()
+    virtual void initialize() {}
+
+    //! \brief shutdown writes what the store has postponed, before the process exits, see SessionManager::shutdown()
+    virtual void shutdown() {}
+
+    //! \brief insert adds a new session, false if the id is taken or the store failed
+    virtual bool insert(const QByteArray &sessionId, const Session &session) = 0;
+
+    //! \brief find returns a session, whether it has timed out is for the caller to decide
+    virtual bool find(const QByteArray &sessionId, Session &session) = 0;
+
+    virtual bool remove(const QByteArray &sessionId) = 0;
+
+    //! \brief touch records that a session was used at a time, the store may write it later
+    virtual void touch(const QByteArray &sessionId, qint64 time) = 0;
+
+    //! \brief isRemote tells if a lookup costs a round trip, SessionManager then puts SessionCache in front
+    virtual bool isRemote() const = 0;
+
+    /*!
+     * \brief create makes a store by its name in "SessionManager/store", e.g. for a benchmark
+     * \param[in] timeoutThreshold seconds after which the sessions of a memory store are swept
+     * \return null if the name is unknown
+     */
+    static SessionStore *create(const QString &name, qint64 timeoutThreshold);
+
+    //! \brief getSingleton returns the store of the settings, made on first use
+    static SessionStore &getSingleton();
+};
+
+#endif // SESSIONSTORE_H
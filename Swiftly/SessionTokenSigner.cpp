@@ -0,0 +1,180 @@
+#include "SessionTokenSigner.h"
+#include "SettingsManager.h"
+#include <sodium.h>
+#include <QDateTime>
+#include <QDebug>
+#include <QtEndian>
+
+static const QByteArray::Base64Options tokenEncoding = QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals;
+
+// the token is the version, the nonce and the ciphertext, the version is authenticated as additional data
+static const int nonceOffset = 1;
+static const int ciphertextOffset = nonceOffset + crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+
+// the plain payload: expiry, user id length, then the user id and the email, both UTF-8
+static const int fixedPayloadSize = 8 + 1;
+
+SessionTokenSigner::SessionTokenSigner()
+    :m_key(),
+      m_revocationEnabled(true),
+      m_revokedLock(),
+      m_revoked(),
+      m_sweptSize(0)
+{
+    m_key = QByteArray::fromBase64(SettingsManager::getSingleton().get("SessionManager/tokenKey").toByteArray());
+    m_revocationEnabled = SettingsManager::getSingleton().get("SessionManager/tokenRevocation", true).toBool();
+
+    if (m_key.size() != crypto_aead_xchacha20poly1305_ietf_KEYBYTES)
+    {
+        qDebug() << "no valid SessionManager/tokenKey, session tokens are sealed with a random key until restart";
+        m_key.resize(crypto_aead_xchacha20poly1305_ietf_KEYBYTES);
+        crypto_aead_xchacha20poly1305_ietf_keygen(reinterpret_cast<unsigned char *>(m_key.data()));
+    }
+}
+
+SessionTokenSigner::~SessionTokenSigner()
+{
+    sodium_memzero(m_key.data(), static_cast<size_t>(m_key.size()));
+}
+
+QByteArray SessionTokenSigner::issue(const QString &userId, const QString &email, qint64 expiresAt) const
+{
+    QByteArray userIdBytes = userId.toUtf8();
+
+    // cutting it would split a character, or worse, name another user
+    if (userIdBytes.size() > m_maxUserIdSize)
+    {
+        qDebug() << "user id too long for a session token:" << userIdBytes.size() << "bytes";
+        return QByteArray();
+    }
+
+    QByteArray payload;
+    QByteArray emailBytes = email.toUtf8();
+    payload.reserve(fixedPayloadSize + userIdBytes.size() + emailBytes.size());
+
+    char expiry[8];
+    qToBigEndian(expiresAt, expiry);
+
+    payload.append(expiry, 8);
+    payload.append(static_cast<char>(userIdBytes.size()));
+    payload.append(userIdBytes);
+    payload.append(emailBytes);
+
+    QByteArray token(ciphertextOffset + payload.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES, '\0');
+    unsigned char *tokenData = reinterpret_cast<unsigned char *>(token.data());
+    token[0] = static_cast<char>(m_version);
+    // random 192 bit nonces don't collide, whatever the number of tokens issued with the key
+    randombytes_buf(tokenData + nonceOffset, crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+
+    crypto_aead_xchacha20poly1305_ietf_encrypt(tokenData + ciphertextOffset, nullptr,
+                                               reinterpret_cast<const unsigned char *>(payload.constData()), static_cast<unsigned long long>(payload.size()),
+                                               tokenData, nonceOffset,
+                                               nullptr, tokenData + nonceOffset,
+                                               reinterpret_cast<const unsigned char *>(m_key.constData()));
+    sodium_memzero(payload.data(), static_cast<size_t>(payload.size()));
+
+    return token.toBase64(tokenEncoding);
+}
+
+bool SessionTokenSigner::open(const QByteArray &token, QByteArray &payload, QByteArray &nonce) const
+{
+    QByteArray decoded = QByteArray::fromBase64(token, tokenEncoding);
+
+    if (decoded.size() < ciphertextOffset + crypto_aead_xchacha20poly1305_ietf_ABYTES + fixedPayloadSize
+            || static_cast<quint8>(decoded.at(0)) != m_version)
+    {
+        return false;
+    }
+
+    const unsigned char *decodedData = reinterpret_cast<const unsigned char *>(decoded.constData());
+    payload.resize(decoded.size() - ciphertextOffset - crypto_aead_xchacha20poly1305_ietf_ABYTES);
+
+    // the tag is checked in constant time, nothing is decrypted from a forged or altered token
+    if (crypto_aead_xchacha20poly1305_ietf_decrypt(reinterpret_cast<unsigned char *>(payload.data()), nullptr, nullptr,
+                                                   decodedData + ciphertextOffset, static_cast<unsigned long long>(decoded.size() - ciphertextOffset),
+                                                   decodedData, nonceOffset,
+                                                   decodedData + nonceOffset,
+                                                   reinterpret_cast<const unsigned char *>(m_key.constData())) != 0)
+    {
+        return false;
+    }
+
+    nonce = decoded.mid(nonceOffset, crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+    return true;
+}
+
+bool SessionTokenSigner::verify(const QByteArray &token, QString &userId, QString &email, qint64 &expiresAt)
+{
+    QByteArray payload;
+    QByteArray nonce;
+
+    if (!open(token, payload, nonce))
+    {
+        return false;
+    }
+
+    qint64 expiry = qFromBigEndian<qint64>(payload.constData());
+    int userIdSize = static_cast<quint8>(payload.at(8));
+
+    if (expiry <= static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t()) || payload.size() < fixedPayloadSize + userIdSize)
+    {
+        return false;
+    }
+
+    if (m_revocationEnabled)
+    {
+        QReadLocker locker(&m_revokedLock);
+
+        if (m_revoked.contains(nonce))
+        {
+            return false;
+        }
+    }
+
+    userId = QString::fromUtf8(payload.constData() + fixedPayloadSize, userIdSize);
+    email = QString::fromUtf8(payload.mid(fixedPayloadSize + userIdSize));
+    expiresAt = expiry;
+    return true;
+}
+
+bool SessionTokenSigner::revoke(const QByteArray &token)
+{
+    QByteArray payload;
+    QByteArray nonce;
+
+    if (!open(token, payload, nonce))
+    {
+        return false;
+    }
+
+    if (!m_revocationEnabled)
+    {
+        return true;
+    }
+
+    qint64 expiry = qFromBigEndian<qint64>(payload.constData());
+    qint64 now = static_cast<qint64>(QDateTime::currentDateTimeUtc().toTime_t());
+
+    QWriteLocker locker(&m_revokedLock);
+    m_revoked.insert(nonce, expiry);
+
+    // tokens that expired meanwhile need no revocation anymore, the list only holds what logged out recently
+    if (m_revoked.size() >= 2 * qMax(m_sweptSize, 64))
+    {
+        for(QHash<QByteArray, qint64>::iterator iter = m_revoked.begin(); iter != m_revoked.end();)
+        {
+            if (iter.value() <= now)
+            {
+                iter = m_revoked.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        m_sweptSize = m_revoked.size();
+    }
+
+    return true;
+}
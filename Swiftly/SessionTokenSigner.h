@@ -0,0 +1,68 @@
+#ifndef SESSIONTOKENSIGNER_H
+#define SESSIONTOKENSIGNER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+
+/*! \brief SessionTokenSigner issues and checks stateless session tokens
+ *
+ * A token carries the user id, the email and the expiry of its session, encrypted and authenticated with
+ * XChaCha20-Poly1305 (libsodium's crypto_aead_xchacha20poly1305_ietf), as base64url(version, nonce, ciphertext). The
+ * cookie doesn't reveal who is logged in, forging or altering one fails the authentication. Checking one needs no
+ * storage, every process sharing the key accepts the tokens of the others.
+ *
+ * The key is read from the setting "SessionManager/tokenKey", 32 bytes in base64. Without it a random key is made at
+ * start up, tokens then don't survive a restart.
+ *
+ * Logging out revokes a token in this process only, by remembering its nonce until the token would have expired
+ * anyway. Revocation can be turned off with "SessionManager/tokenRevocation", a logged out token then stays valid
+ * until it expires.
+ */
+class SessionTokenSigner
+{
+    QByteArray m_key;
+    bool m_revocationEnabled;
+
+    QReadWriteLock m_revokedLock;
+    // expiry in seconds since epoch, by nonce
+    QHash<QByteArray, qint64> m_revoked;
+    // the size after the last sweep, the next one runs once it has doubled
+    int m_sweptSize;
+
+    SessionTokenSigner();
+    ~SessionTokenSigner();
+
+    //! \brief open decrypts a token, false if it is malformed or doesn't authenticate
+    bool open(const QByteArray &token, QByteArray &payload, QByteArray &nonce) const;
+
+public:
+    static const quint8 m_version = 2;
+    //! user ids are stored with a one byte length
+    static const int m_maxUserIdSize = 255;
+
+    static SessionTokenSigner &getSingleton()
+    {
+        static SessionTokenSigner obj;
+        return obj;
+    }
+
+    /*!
+     * \param[in] expiresAt seconds since epoch
+     * \return the token, empty if the user id is longer than m_maxUserIdSize bytes in UTF-8
+     */
+    QByteArray issue(const QString &userId, const QString &email, qint64 expiresAt) const;
+
+    /*!
+     * \brief verify checks the signature, expiry and revocation of a token
+     * \param[out] expiresAt seconds since epoch
+     * \return false if the token is malformed, forged, expired or revoked, the outputs are then untouched
+     */
+    bool verify(const QByteArray &token, QString &userId, QString &email, qint64 &expiresAt);
+
+    //! \brief revoke makes a valid token fail verify() until it expires, false if it wasn't valid
+    bool revoke(const QByteArray &token);
+};
+
+#endif // SESSIONTOKENSIGNER_H
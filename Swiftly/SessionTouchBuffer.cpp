@@ -0,0 +1,121 @@
+#include "SessionTouchBuffer.h"
+#include "MongodbManager.h"
+#include "SettingsManager.h"
+#include <QDebug>
+#include <bsoncxx/builder/stream/document.hpp>
+#include <mongocxx/client.hpp>
+#include <mongocxx/bulk_write.hpp>
+#include <mongocxx/model/update_one.hpp>
+#include <mongocxx/options/bulk_write.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+
+SessionTouchBuffer::SessionTouchBuffer()
+    :m_thread(),
+      m_timer(new QTimer()),
+      m_mutex(),
+      m_pending(),
+      m_maximumPending(10000),
+      m_written(0),
+      m_flushes(0)
+{
+    m_maximumPending = SettingsManager::getSingleton().get("SessionManager/maximumPendingTouches", 10000).toInt();
+    m_timer->setInterval(SettingsManager::getSingleton().get("SessionManager/touchFlushSeconds", 5).toInt() * 1000);
+    QObject::connect(m_timer, &QTimer::timeout, m_timer, [this](){ flush(); });
+
+    m_thread.setObjectName("SessionTouchBuffer");
+    m_timer->moveToThread(&m_thread);
+    m_thread.start();
+
+    QMetaObject::invokeMethod(m_timer, [this](){ m_timer->start(); }, Qt::QueuedConnection);
+}
+
+SessionTouchBuffer::~SessionTouchBuffer()
+{
+    stop();
+    delete m_timer;
+}
+
+void SessionTouchBuffer::stop()
+{
+    if (m_thread.isRunning())
+    {
+        m_thread.quit();
+        m_thread.wait();
+    }
+}
+
+void SessionTouchBuffer::shutdown()
+{
+    // the timer thread first, so that the last flush doesn't race a periodic one
+    stop();
+    flush();
+}
+
+void SessionTouchBuffer::touch(const QByteArray &sessionId, qint64 time)
+{
+    m_mutex.lock();
+    m_pending.insert(sessionId, time);
+    bool full = m_pending.size() == m_maximumPending;
+    m_mutex.unlock();
+
+    if (full)
+    {
+        // only the touch that fills the buffer asks, the flush empties it
+        QMetaObject::invokeMethod(m_timer, [this](){ flush(); }, Qt::QueuedConnection);
+    }
+}
+
+int SessionTouchBuffer::pending()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.size();
+}
+
+void SessionTouchBuffer::flush()
+{
+    QHash<QByteArray, qint64> pending;
+
+    m_mutex.lock();
+    pending.swap(m_pending);
+    m_mutex.unlock();
+
+    if (pending.isEmpty())
+    {
+        return;
+    }
+
+    auto client = MongodbManager::getSingleton().getClient();
+
+    mongocxx::database swiftlyDb = (*client)["Swiftly"];
+    mongocxx::collection sessionCollection = swiftlyDb["Session"];
+
+    // a session deleted meanwhile matches nothing, that must not hold back the other updates
+    mongocxx::options::bulk_write options;
+    options.ordered(false);
+    mongocxx::bulk_write bulk{options};
+
+    for(QHash<QByteArray, qint64>::ConstIterator iter = pending.constBegin(); iter != pending.constEnd(); ++iter)
+    {
+        mongocxx::model::update_one update{bsoncxx::builder::stream::document{}
+                                           << "session_id" << QString::fromLatin1(iter.key()).toStdString().c_str()
+                                           << bsoncxx::builder::stream::finalize,
+                                           bsoncxx::builder::stream::document{} << "$set"
+                                           << bsoncxx::builder::stream::open_document
+                                           << "time" << static_cast<std::int64_t>(iter.value())
+                                           << bsoncxx::builder::stream::close_document
+                                           << bsoncxx::builder::stream::finalize};
+        bulk.append(update);
+    }
+
+    try
+    {
+        sessionCollection.bulk_write(bulk);
+        m_written.fetchAndAddRelaxed(static_cast<quint64>(pending.size()));
+        m_flushes.fetchAndAddRelaxed(1);
+    }
+    catch(const mongocxx::bulk_write_exception &e)
+    {
+        // the sessions stay valid, they only look idle for longer than they are
+        qDebug() << "writing" << pending.size() << "session touches failed:" << e.what();
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SESSIONTOUCHBUFFER_H
+#define SESSIONTOUCHBUFFER_H
+
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QHash>
+#include <QByteArray>
+#include <QAtomicInteger>
+
+/*! \brief SessionTouchBuffer collects the "time" updates of active sessions and writes them in batches
+ *
+ * MongoSessionStore::touch() records a touch here instead of updating the session document right away. On a thread
+ * of its own, the buffer writes every pending touch with one unordered bulk write, every
+ * "SessionManager/touchFlushSeconds" (5 by default), or as soon as "SessionManager/maximumPendingTouches" (10000)
+ * sessions are waiting. A session touched several times in between is written once, with its latest time. Touches
+ * still pending at exit are written by shutdown(), see SessionManager::shutdown(), not by the destructor, which runs
+ * when the database client may already be gone.
+ */
+class SessionTouchBuffer
+{
+    QThread m_thread;
+    // lives on m_thread
+    QTimer *m_timer;
+    QMutex m_mutex;
+    // seconds since epoch by session id
+    QHash<QByteArray, qint64> m_pending;
+    int m_maximumPending;
+    QAtomicInteger<quint64> m_written;
+    QAtomicInteger<quint64> m_flushes;
+
+    SessionTouchBuffer();
+    ~SessionTouchBuffer();
+
+    void stop();
+    void flush();
+
+public:
+    static SessionTouchBuffer &getSingleton()
+    {
+        static SessionTouchBuffer obj;
+        return obj;
+    }
+
+    //! \brief touch records that a session was used at a time, in seconds since epoch
+    void touch(const QByteArray &sessionId, qint64 time);
+
+    //! \brief shutdown stops the periodic writes and writes what is pending, once no worker touches sessions anymore
+    void shutdown();
+
+    int pending();
+
+    //! \brief written counts the touches written to the database
+    quint64 written() const
+    {
+        return m_written.load();
+    }
+
+    //! \brief flushes counts the bulk writes that carried them
+    quint64 flushes() const
+    {
+        return m_flushes.load();
+    }
+};
+
+#endif // SESSIONTOUCHBUFFER_H
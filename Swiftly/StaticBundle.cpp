@@ -0,0 +1,236 @@
+#include "StaticBundle.h"
+#include "StaticFileServer.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+#include <QStringBuilder>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+static const char bundleMagic[8] = {'S', 'W', 'B', 'U', 'N', 'D', 'L', 'E'};
+static const quint32 byteOrderMark = 0x01020304;
+
+static int compareUtf16(const ushort *a, int aLength, const ushort *b, int bLength)
+{
+    int length = qMin(aLength, bLength);
+
+    for(int i = 0; i < length; ++i)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+
+    return aLength - bLength;
+}
+
+StaticBundle::Builder::Builder()
+    :m_files()
+{
+}
+
+void StaticBundle::Builder::addFile(const File &file)
+{
+    m_files.push_back(file);
+}
+
+bool StaticBundle::Builder::save(const QString &fileName, QString &errorString)
+{
+    std::sort(m_files.begin(), m_files.end(), [](const File &a, const File &b){
+        return compareUtf16(a.m_path.utf16(), a.m_path.size(), b.m_path.utf16(), b.m_path.size()) < 0;
+    });
+
+    QVector<Entry> entries(m_files.size());
+    // the bytes after the entry array, each with the offset it goes to, contents are shared, not copied
+    QVector<QPair<quint64, QByteArray>> chunks;
+    quint64 offset = sizeof(Header) + sizeof(Entry) * static_cast<quint64>(m_files.size());
+
+    auto place = [&chunks, &offset](const QByteArray &bytes, quint64 alignment) {
+        offset = (offset + alignment - 1) / alignment * alignment;
+        Range range;
+        range.m_offset = offset;
+        range.m_length = static_cast<quint64>(bytes.size());
+        chunks.push_back(qMakePair(offset, bytes));
+        offset += range.m_length;
+        return range;
+    };
+
+    for(int i = 0; i < m_files.size(); ++i)
+    {
+        const File &file = m_files[i];
+        Entry &entry = entries[i];
+        std::memset(&entry, 0, sizeof(Entry));
+
+        if (i > 0 && file.m_path == m_files[i - 1].m_path)
+        {
+            errorString = "duplicate path " % file.m_path;
+            return false;
+        }
+
+        if (file.m_content[static_cast<int>(ContentEncoding::Identity)].isNull())
+        {
+            errorString = "no content for " % file.m_path;
+            return false;
+        }
+
+        Range path = place(QByteArray(reinterpret_cast<const char*>(file.m_path.utf16()), file.m_path.size() * 2), 2);
+        path.m_length = static_cast<quint64>(file.m_path.size());
+        entry.m_path = path;
+        entry.m_mimeType = place(file.m_mimeType.toLatin1(), 1);
+        entry.m_etag = place(file.m_etag.toLatin1(), 1);
+        entry.m_lastModifiedInMilliseconds = file.m_lastModified.toMSecsSinceEpoch();
+
+        bool varies = false;
+
+        for(int e = static_cast<int>(ContentEncoding::Identity) + 1; e < ContentEncodingCount; ++e)
+        {
+            varies = varies || !file.m_content[e].isNull();
+        }
+
+        for(int e = 0; e < ContentEncodingCount; ++e)
+        {
+            if (file.m_content[e].isNull())
+            {
+                continue;
+            }
+
+            ContentEncoding encoding = static_cast<ContentEncoding>(e);
+            QByteArray preparedHeader = StaticFileServer::prepareHeader(file.m_content[e].size(), file.m_mimeType, encoding,
+                                                                        StaticFileServer::variantETag(file.m_etag, encoding),
+                                                                        file.m_lastModified, varies);
+            entry.m_encodings |= 1u << e;
+            entry.m_preparedHeader[e] = place(preparedHeader, 1);
+            // contents start on their own cache line
+            entry.m_content[e] = place(file.m_content[e], 64);
+        }
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.m_magic, bundleMagic, sizeof(bundleMagic));
+    header.m_byteOrderMark = byteOrderMark;
+    header.m_version = m_version;
+    header.m_entryCount = static_cast<quint64>(entries.size());
+    header.m_entriesOffset = sizeof(Header);
+
+    QSaveFile bundle(fileName);
+
+    if (!bundle.open(QFile::WriteOnly))
+    {
+        errorString = bundle.errorString();
+        return false;
+    }
+
+    bundle.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    bundle.write(reinterpret_cast<const char*>(entries.constData()), static_cast<qint64>(sizeof(Entry)) * entries.size());
+
+    quint64 written = sizeof(Header) + sizeof(Entry) * static_cast<quint64>(entries.size());
+
+    for(int i = 0; i < chunks.size(); ++i)
+    {
+        if (chunks[i].first > written)
+        {
+            bundle.write(QByteArray(static_cast<int>(chunks[i].first - written), '\0'));
+        }
+
+        bundle.write(chunks[i].second);
+        written = chunks[i].first + static_cast<quint64>(chunks[i].second.size());
+    }
+
+    if (!bundle.commit())
+    {
+        errorString = bundle.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+StaticBundle::StaticBundle(const QString &fileName)
+    :m_mapping(),
+      m_entries(nullptr),
+      m_entryCount(0)
+{
+    QFileInfo fileInfo(fileName);
+    m_mapping = MappedFileRegistry::getSingleton().acquire(fileInfo.canonicalFilePath(), fileInfo.size(), fileInfo.lastModified());
+
+    if (m_mapping.isNull() || static_cast<quint64>(m_mapping->size()) < sizeof(Header))
+    {
+        qDebug() << "can't map static bundle" << fileName;
+        return;
+    }
+
+    quint64 size = static_cast<quint64>(m_mapping->size());
+    const Header *header = reinterpret_cast<const Header*>(m_mapping->data());
+
+    if (std::memcmp(header->m_magic, bundleMagic, sizeof(bundleMagic)) != 0 || header->m_byteOrderMark != byteOrderMark
+            || header->m_version != m_version || header->m_entryCount > static_cast<quint64>(INT_MAX)
+            || header->m_entriesOffset % alignof(Entry) != 0 || header->m_entriesOffset > size
+            || header->m_entryCount > (size - header->m_entriesOffset) / sizeof(Entry))
+    {
+        qDebug() << "not a static bundle of this version" << fileName;
+        return;
+    }
+
+    const Entry *entries = reinterpret_cast<const Entry*>(m_mapping->data() + header->m_entriesOffset);
+    int entryCount = static_cast<int>(header->m_entryCount);
+
+    // checked once here, serving then trusts the offsets
+    auto fits = [size](const Range &range) {
+        return range.m_offset <= size && range.m_length <= size - range.m_offset;
+    };
+
+    for(int i = 0; i < entryCount; ++i)
+    {
+        const Entry &entry = entries[i];
+        bool valid = entry.m_path.m_offset % 2 == 0 && entry.m_path.m_length <= size / 2 && fits(Range{entry.m_path.m_offset, entry.m_path.m_length * 2})
+                && fits(entry.m_mimeType) && fits(entry.m_etag) && entry.hasEncoding(ContentEncoding::Identity);
+
+        for(int e = 0; valid && e < ContentEncodingCount; ++e)
+        {
+            valid = !entry.hasEncoding(static_cast<ContentEncoding>(e))
+                    || (fits(entry.m_content[e]) && fits(entry.m_preparedHeader[e]) && entry.m_content[e].m_length <= static_cast<quint64>(INT_MAX));
+        }
+
+        if (!valid)
+        {
+            qDebug() << "corrupt static bundle" << fileName << "entry" << i;
+            return;
+        }
+    }
+
+    m_entries = entries;
+    m_entryCount = entryCount;
+}
+
+const StaticBundle::Entry *StaticBundle::find(const QString &path) const
+{
+    const ushort *key = path.utf16();
+    int keyLength = path.size();
+    int low = 0;
+    int high = m_entryCount - 1;
+
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+        const Entry &entry = m_entries[middle];
+        int comparison = compareUtf16(reinterpret_cast<const ushort*>(data(entry.m_path)), static_cast<int>(entry.m_path.m_length), key, keyLength);
+
+        if (comparison == 0)
+        {
+            return &entry;
+        }
+        else if (comparison < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return nullptr;
+}
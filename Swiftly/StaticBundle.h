@@ -0,0 +1,152 @@
+#ifndef STATICBUNDLE_H
+#define STATICBUNDLE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QVector>
+#include <QSharedPointer>
+#include "Compression.h"
+#include "MappedFile.h"
+
+/*! \brief StaticBundle is a packed archive of static files, mapped read only and served in place
+ *
+ * A bundle is made offline by the Pack tool. It holds, for every file, its content in each encoding, the header
+ * of a full response for each of them, the entity tag, mime type and modification time. Entries are sorted by path,
+ * a lookup is a binary search over the mapping that compares the request path in place and allocates nothing. The
+ * mapping is shared by every worker through MappedFileRegistry, opening a bundle reads nothing but its header.
+ *
+ * Layout, in host byte order: Header, the Entry array, then the strings and contents the entries point at. Paths are
+ * stored as UTF-16, so they compare with QString directly, mime types and entity tags as Latin-1.
+ */
+class StaticBundle
+{
+public:
+    //! \brief Range locates bytes in the bundle, counted from its start
+    class Range
+    {
+    public:
+        quint64 m_offset;
+        quint64 m_length;
+    };
+
+    class Header
+    {
+    public:
+        char m_magic[8];
+        // written as 0x01020304, a bundle packed on a host of the other byte order is refused
+        quint32 m_byteOrderMark;
+        quint32 m_version;
+        quint64 m_entryCount;
+        quint64 m_entriesOffset;
+    };
+
+    class Entry
+    {
+    public:
+        // m_length is in UTF-16 code units
+        Range m_path;
+        Range m_mimeType;
+        // of the identity encoding, see StaticFileServer::variantETag()
+        Range m_etag;
+        qint64 m_lastModifiedInMilliseconds;
+        quint32 m_encodings;
+        quint32 m_reserved;
+        // indexed by ContentEncoding, only those set in m_encodings are present
+        Range m_content[ContentEncodingCount];
+        Range m_preparedHeader[ContentEncodingCount];
+
+        bool hasEncoding(ContentEncoding encoding) const
+        {
+            return m_encodings & (1u << static_cast<int>(encoding));
+        }
+    };
+
+    /*! \brief Builder collects files and writes them as a bundle
+     */
+    class Builder
+    {
+    public:
+        class File
+        {
+        public:
+            QString m_path;
+            QString m_mimeType;
+            QString m_etag;
+            QDateTime m_lastModified;
+            // indexed by ContentEncoding, null for the encodings the file doesn't have, identity is required
+            QByteArray m_content[ContentEncodingCount];
+        };
+
+    private:
+        QVector<File> m_files;
+
+    public:
+        Builder();
+
+        //! \param[in] file its path is the one requests will use, e.g. "/css/site.css"
+        void addFile(const File &file);
+
+        int fileCount() const
+        {
+            return m_files.size();
+        }
+
+        //! \brief save writes the bundle, replacing the file only once it has been written completely
+        bool save(const QString &fileName, QString &errorString);
+    };
+
+private:
+    QSharedPointer<MappedFile> m_mapping;
+    const Entry *m_entries;
+    int m_entryCount;
+
+public:
+    static const quint32 m_version = 1;
+
+    //! \brief StaticBundle maps a bundle and checks its layout, see isValid()
+    StaticBundle(const QString &fileName);
+
+    bool isValid() const
+    {
+        return m_entries != nullptr;
+    }
+
+    int entryCount() const
+    {
+        return m_entryCount;
+    }
+
+    //! \brief find looks up the entry of a request path, nullptr if there is none
+    const Entry *find(const QString &path) const;
+
+    //! \brief entry returns an entry by index, entries are sorted by path
+    const Entry &entry(int index) const
+    {
+        return m_entries[index];
+    }
+
+    const char *data(const Range &range) const
+    {
+        return m_mapping->data() + range.m_offset;
+    }
+
+    //! \brief bytes wraps bytes of the mapping without copying them, the bundle must outlive the result
+    QByteArray bytes(const Range &range) const
+    {
+        return QByteArray::fromRawData(data(range), static_cast<int>(range.m_length));
+    }
+
+    QString latin1(const Range &range) const
+    {
+        return QString::fromLatin1(data(range), static_cast<int>(range.m_length));
+    }
+
+    //! \brief utf16 copies a string stored as UTF-16, e.g. Entry::m_path
+    QString utf16(const Range &range) const
+    {
+        return QString(reinterpret_cast<const QChar*>(data(range)), static_cast<int>(range.m_length));
+    }
+};
+
+#endif // STATICBUNDLE_H
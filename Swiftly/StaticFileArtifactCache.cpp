@@ -0,0 +1,151 @@
+#include "StaticFileArtifactCache.h"
+#include "SettingsManager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringBuilder>
+#include <QThreadPool>
+
+static const char *digestSuffix = ".etag";
+
+//! \brief ArtifactExpiryTask deletes the artifacts nobody has written for a while, on the global thread pool
+class ArtifactExpiryTask : public QRunnable
+{
+private:
+    QString m_directory;
+    int m_maxAgeInDays;
+
+public:
+    ArtifactExpiryTask(const QString &directory, int maxAgeInDays)
+        :QRunnable(),
+          m_directory(directory),
+          m_maxAgeInDays(maxAgeInDays)
+    {}
+
+    void run() override
+    {
+        QDateTime expiry = QDateTime::currentDateTime().addDays(-m_maxAgeInDays);
+        int removed = 0;
+
+        QDirIterator iter(m_directory, QDir::Files, QDirIterator::Subdirectories);
+        while (iter.hasNext())
+        {
+            iter.next();
+
+            if (iter.fileInfo().lastModified() < expiry && QFile::remove(iter.filePath()))
+            {
+                ++removed;
+            }
+        }
+
+        if (removed)
+        {
+            qDebug() << "removed" << removed << "expired static file artifacts";
+        }
+    }
+};
+
+StaticFileArtifactCache::StaticFileArtifactCache()
+    :m_directory()
+{
+    if (!SettingsManager::getSingleton().get("StaticFileCache/persistArtifacts", true).toBool())
+    {
+        return;
+    }
+
+    QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString directory = SettingsManager::getSingleton().get("StaticFileCache/artifactDirectory",
+                                                            cacheLocation.isEmpty() ? QString() : cacheLocation % "/static-artifacts").toString();
+
+    if (directory.isEmpty() || !QDir().mkpath(directory))
+    {
+        qDebug() << "static file artifacts are not persisted, no usable directory" << directory;
+        return;
+    }
+
+    m_directory = QDir(directory).absolutePath();
+
+    int maxAgeInDays = SettingsManager::getSingleton().get("StaticFileCache/artifactMaxAgeDays", 30).toInt();
+
+    if (maxAgeInDays > 0)
+    {
+        QThreadPool::globalInstance()->start(new ArtifactExpiryTask(m_directory, maxAgeInDays));
+    }
+}
+
+QString StaticFileArtifactCache::pathOf(const QString &key, const QString &suffix) const
+{
+    // spread over 256 subdirectories, a directory of a million entries is slow to look up on some file systems
+    return m_directory % "/" % key.left(2) % "/" % key % suffix;
+}
+
+bool StaticFileArtifactCache::load(const QString &key, const QString &suffix, QByteArray &content) const
+{
+    if (m_directory.isEmpty() || key.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(pathOf(key, suffix));
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+
+    content = file.readAll();
+    return true;
+}
+
+void StaticFileArtifactCache::store(const QString &key, const QString &suffix, const QByteArray &content) const
+{
+    if (m_directory.isEmpty() || key.isEmpty())
+    {
+        return;
+    }
+
+    QString path = pathOf(key, suffix);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // renamed into place once complete, a crash never leaves a truncated artifact behind
+    QSaveFile file(path);
+
+    if (!file.open(QFile::WriteOnly) || file.write(content) != content.size() || !file.commit())
+    {
+        qDebug() << "can't write static file artifact" << path;
+    }
+}
+
+bool StaticFileArtifactCache::loadDigest(const QString &key, QString &etag) const
+{
+    QByteArray content;
+
+    if (!load(key, digestSuffix, content) || content.isEmpty())
+    {
+        return false;
+    }
+
+    etag = QString::fromLatin1(content);
+    return true;
+}
+
+void StaticFileArtifactCache::storeDigest(const QString &key, const QString &etag) const
+{
+    store(key, digestSuffix, etag.toLatin1());
+}
+
+bool StaticFileArtifactCache::loadVariant(const QString &key, ContentEncoding encoding, QByteArray &content) const
+{
+    return load(key, contentEncodingSuffix(encoding), content);
+}
+
+void StaticFileArtifactCache::storeVariant(const QString &key, ContentEncoding encoding, const QByteArray &content) const
+{
+    store(key, contentEncodingSuffix(encoding), content);
+}
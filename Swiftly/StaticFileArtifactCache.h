@@ -0,0 +1,55 @@
+#ifndef STATICFILEARTIFACTCACHE_H
+#define STATICFILEARTIFACTCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include "Compression.h"
+
+/*! \brief StaticFileArtifactCache keeps the digests and compressed variants of static files on disk, across restarts
+ *
+ * Artifacts are keyed by the identity of the file they were made from, its inode, modification time and size, see
+ * StaticFileServer. A file replaced or modified gets a new key, stale artifacts are simply never asked for again, and
+ * are deleted once they are older than StaticFileCache/artifactMaxAgeDays (30). Nothing is loaded at startup, an
+ * artifact is read when its file is first cached, or its variant first requested, instead of hashing or compressing.
+ *
+ * A variant that wasn't worth compressing is stored empty, so it isn't tried again either.
+ *
+ * Settings: StaticFileCache/persistArtifacts (true), StaticFileCache/artifactDirectory (static-artifacts in the
+ * application's cache location).
+ */
+class StaticFileArtifactCache
+{
+    QString m_directory;
+
+    StaticFileArtifactCache();
+
+    QString pathOf(const QString &key, const QString &suffix) const;
+    bool load(const QString &key, const QString &suffix, QByteArray &content) const;
+    void store(const QString &key, const QString &suffix, const QByteArray &content) const;
+
+public:
+    static StaticFileArtifactCache &getSingleton()
+    {
+        static StaticFileArtifactCache obj;
+        return obj;
+    }
+
+    bool isEnabled() const
+    {
+        return !m_directory.isEmpty();
+    }
+
+    //! \brief loadDigest reads the entity tag computed from a file's content, false if there is none
+    bool loadDigest(const QString &key, QString &etag) const;
+    void storeDigest(const QString &key, const QString &etag) const;
+
+    /*!
+     * \brief loadVariant reads a compressed variant
+     * \param[out] content the variant, empty if it wasn't smaller than the file
+     * \return false if the variant has never been stored
+     */
+    bool loadVariant(const QString &key, ContentEncoding encoding, QByteArray &content) const;
+    void storeVariant(const QString &key, ContentEncoding encoding, const QByteArray &content) const;
+};
+
+#endif // STATICFILEARTIFACTCACHE_H
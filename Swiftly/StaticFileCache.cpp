@@ -0,0 +1,513 @@
+#include "StaticFileCache.h"
+#include "MemoryPressureMonitor.h"
+#include "SettingsManager.h"
+#include <QDebug>
+#include <QDateTime>
+#include <QThread>
+#include <QStringBuilder>
+
+// the shared timestamp is written at most once a second per item, a hot item's cache line then stays shared
+static inline void touch(const StaticFileCache::Item &item)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (now - item->m_lastAccess.load() > 1000)
+    {
+        item->m_lastAccess.store(now);
+    }
+}
+
+StaticFileCache::LocalCache::LocalCache()
+    :m_slots(),
+      m_checkedGeneration(0),
+      m_flushedGeneration(0),
+      m_statistics(StaticFileCache::getSingleton().registerStatistics()),
+      m_accesses(),
+      m_accessCount(0)
+{
+}
+
+StaticFileCache::StaticFileCache()
+    :m_shards(),
+      m_budgetInKB(0),
+      m_shardCapacityInKB(0),
+      m_evictions(0),
+      m_generation(1),
+      m_flushGeneration(1),
+      m_nullItem(),
+      m_sketchMutex(),
+      m_sketch(),
+      m_statisticsMutex(),
+      m_statistics()
+{
+    qint64 budgetInKB = SettingsManager::getSingleton().get("StaticFileCache/budgetMB", 0).toLongLong() * 1024;
+
+    if (budgetInKB <= 0)
+    {
+        // half of the memory the process may use, in KB
+        budgetInKB = MemoryPressureMonitor::memoryLimit() / 2048;
+    }
+
+    qDebug() << "static file cache budget in MB:" << budgetInKB / 1024;
+    m_budgetInKB.store(budgetInKB);
+    m_shardCapacityInKB.store(budgetInKB / m_shardCount);
+}
+
+StaticFileCache &StaticFileCache::getSingleton()
+{
+    static StaticFileCache obj;
+    return obj;
+}
+
+StaticFileCache::LocalCache &StaticFileCache::localCache()
+{
+    static thread_local LocalCache localCache;
+    return localCache;
+}
+
+StaticFileCache::Statistics *StaticFileCache::registerStatistics()
+{
+    QString threadName = QThread::currentThread()->objectName();
+    Statistics *statistics = new Statistics(threadName.isEmpty() ? QString("thread %1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId())) : threadName);
+
+    QMutexLocker locker(&m_statisticsMutex);
+    m_statistics.push_back(statistics);
+    return statistics;
+}
+
+QVector<const StaticFileCache::Statistics*> StaticFileCache::statistics()
+{
+    QMutexLocker locker(&m_statisticsMutex);
+
+    QVector<const Statistics*> result;
+    result.reserve(m_statistics.size());
+    for(int i = 0; i < m_statistics.size(); ++i)
+    {
+        result.push_back(m_statistics[i]);
+    }
+    return result;
+}
+
+void StaticFileCache::setCapacityInKB(qint64 capacityInKB)
+{
+    qint64 shardCapacity = qMax<qint64>(capacityInKB / m_shardCount, 1);
+    qint64 previous = m_shardCapacityInKB.fetchAndStoreOrdered(shardCapacity);
+
+    if (shardCapacity >= previous)
+    {
+        return;
+    }
+
+    for(int i = 0; i < m_shardCount; ++i)
+    {
+        Shard &shard = m_shards[i];
+
+        shard.m_lock.lockForWrite();
+        if (shard.m_costInKB > shardCapacity)
+        {
+            evict(shard);
+        }
+        shard.m_lock.unlock();
+    }
+
+    m_flushGeneration.fetchAndAddRelease(1);
+}
+
+void StaticFileCache::recordTransfer(qint64 identitySize, qint64 sentSize)
+{
+    Statistics *statistics = localCache().m_statistics;
+    statistics->m_bytesSent.store(statistics->m_bytesSent.load() + static_cast<quint64>(sentSize));
+    statistics->m_bytesSaved.store(statistics->m_bytesSaved.load() + static_cast<quint64>(identitySize - sentSize));
+}
+
+StaticFileCache::Usage StaticFileCache::usage()
+{
+    Usage result;
+
+    for(int i = 0; i < m_shardCount; ++i)
+    {
+        Shard &shard = m_shards[i];
+
+        shard.m_lock.lockForRead();
+        result.m_entries += shard.m_items.size();
+        result.m_costInKB += shard.m_costInKB;
+        shard.m_lock.unlock();
+    }
+
+    return result;
+}
+
+const StaticFileCache::Item & StaticFileCache::find(const QString &canonicalPath)
+{
+    LocalCache &local = localCache();
+    uint hash = qHash(canonicalPath);
+    // loaded before the shared lookup, an item invalidated meanwhile leaves the slot with a stale generation
+    quint64 shardGeneration = m_shards[hash % m_shardCount].m_generation.loadAcquire();
+    LocalCache::Slot &slot = local.m_slots[hash % LocalCache::m_slotCount];
+
+    recordAccess(local, hash);
+
+    quint64 flushGeneration = m_flushGeneration.loadAcquire();
+    quint64 generation = m_generation.loadAcquire();
+    if (local.m_flushedGeneration != flushGeneration)
+    {
+        local.m_flushedGeneration = flushGeneration;
+        local.m_checkedGeneration = generation;
+        flush(local);
+    }
+    else if (local.m_checkedGeneration != generation)
+    {
+        local.m_checkedGeneration = generation;
+        release(local);
+    }
+
+    if (slot.m_generation == shardGeneration && slot.m_canonicalPath == canonicalPath && !slot.m_item.isNull())
+    {
+        local.m_statistics->m_l1Hits.store(local.m_statistics->m_l1Hits.load() + 1);
+        touch(slot.m_item);
+        return slot.m_item;
+    }
+
+    Item item = findShared(canonicalPath);
+
+    if (item.isNull())
+    {
+        local.m_statistics->m_misses.store(local.m_statistics->m_misses.load() + 1);
+        return m_nullItem;
+    }
+
+    local.m_statistics->m_l2Hits.store(local.m_statistics->m_l2Hits.load() + 1);
+    slot.m_canonicalPath = canonicalPath;
+    slot.m_item = item;
+    slot.m_generation = shardGeneration;
+    return slot.m_item;
+}
+
+void StaticFileCache::recordAccess(LocalCache &local, uint hash)
+{
+    local.m_accesses[local.m_accessCount++] = hash;
+
+    if (local.m_accessCount == LocalCache::m_accessBufferSize)
+    {
+        // a batch is dropped rather than waited for when another thread holds the sketch, frequencies are estimates
+        if (m_sketchMutex.tryLock())
+        {
+            for(int i = 0; i < local.m_accessCount; ++i)
+            {
+                m_sketch.increment(local.m_accesses[i]);
+            }
+            m_sketchMutex.unlock();
+        }
+
+        local.m_accessCount = 0;
+    }
+}
+
+void StaticFileCache::release(LocalCache &local)
+{
+    // a slot holds a strong reference, left alone it would keep an evicted or replaced item in memory
+    for(int i = 0; i < LocalCache::m_slotCount; ++i)
+    {
+        LocalCache::Slot &slot = local.m_slots[i];
+
+        // the slot count is a multiple of the shard count, a slot only ever holds items of one shard
+        if (!slot.m_item.isNull() && slot.m_generation != m_shards[i % m_shardCount].m_generation.loadAcquire())
+        {
+            slot.m_canonicalPath.clear();
+            slot.m_item.clear();
+        }
+    }
+}
+
+void StaticFileCache::flush(LocalCache &local)
+{
+    // under memory pressure, even the slots still valid go, the next lookups refill them from the shards
+    for(int i = 0; i < LocalCache::m_slotCount; ++i)
+    {
+        local.m_slots[i].m_canonicalPath.clear();
+        local.m_slots[i].m_item.clear();
+    }
+}
+
+StaticFileCache::Item StaticFileCache::findShared(const QString &canonicalPath)
+{
+    Shard &shard = shardFor(canonicalPath);
+    Item item;
+
+    shard.m_lock.lockForRead();
+    QHash<QString, Item>::const_iterator iter = shard.m_items.constFind(canonicalPath);
+    if (iter != shard.m_items.constEnd())
+    {
+        item = iter.value();
+    }
+    shard.m_lock.unlock();
+
+    if (!item.isNull())
+    {
+        touch(item);
+    }
+
+    return item;
+}
+
+void StaticFileCache::insert(const QString &canonicalPath, const Item &item)
+{
+    Shard &shard = shardFor(canonicalPath);
+    qint64 cost = qMax<qint64>(item->sizeInKB(), 1);
+
+    if (cost > m_shardCapacityInKB.load())
+    {
+        return;
+    }
+
+    item->m_costInKB = cost;
+    item->m_lastAccess.store(QDateTime::currentMSecsSinceEpoch());
+    item->m_queuedAt = item->m_lastAccess.load();
+    item->m_cacheKey = canonicalPath;
+
+    shard.m_lock.lockForWrite();
+    QHash<QString, Item>::iterator iter = shard.m_items.find(canonicalPath);
+    if (iter != shard.m_items.end())
+    {
+        // a changed file keeps the place its previous version had earned
+        item->m_inWindow = iter.value()->m_inWindow;
+        shard.m_costInKB -= iter.value()->m_costInKB;
+        if (iter.value()->m_inWindow)
+        {
+            shard.m_windowCostInKB -= iter.value()->m_costInKB;
+        }
+        segmentOf(shard, iter.value().data()).unlink(iter.value().data());
+        iter.value() = item;
+        invalidate(shard);
+    }
+    else
+    {
+        item->m_inWindow = true;
+        shard.m_items.insert(canonicalPath, item);
+    }
+    segmentOf(shard, item.data()).pushFront(item.data());
+    shard.m_costInKB += cost;
+    if (item->m_inWindow)
+    {
+        shard.m_windowCostInKB += cost;
+    }
+
+    if (shard.m_costInKB > m_shardCapacityInKB.load())
+    {
+        evict(shard);
+    }
+    shard.m_lock.unlock();
+}
+
+void StaticFileCache::addCost(const QString &canonicalPath, const Item &item, qint64 costInKB)
+{
+    Shard &shard = shardFor(canonicalPath);
+
+    shard.m_lock.lockForWrite();
+    QHash<QString, Item>::iterator iter = shard.m_items.find(canonicalPath);
+    if (iter != shard.m_items.end() && iter.value() == item)
+    {
+        item->m_costInKB += costInKB;
+        shard.m_costInKB += costInKB;
+        if (item->m_inWindow)
+        {
+            shard.m_windowCostInKB += costInKB;
+        }
+
+        if (shard.m_costInKB > m_shardCapacityInKB.load())
+        {
+            evict(shard);
+        }
+    }
+    shard.m_lock.unlock();
+}
+
+void StaticFileCache::remove(const QString &canonicalPath)
+{
+    Shard &shard = shardFor(canonicalPath);
+
+    shard.m_lock.lockForWrite();
+    QHash<QString, Item>::iterator iter = shard.m_items.find(canonicalPath);
+    if (iter != shard.m_items.end())
+    {
+        erase(shard, iter);
+        invalidate(shard);
+    }
+    shard.m_lock.unlock();
+}
+
+QStringList StaticFileCache::removeDirectory(const QString &canonicalDirectoryPath)
+{
+    QString prefix = canonicalDirectoryPath % "/";
+    QStringList removed;
+
+    for(int i = 0; i < m_shardCount; ++i)
+    {
+        Shard &shard = m_shards[i];
+
+        int removedCount = removed.size();
+
+        shard.m_lock.lockForWrite();
+        for(QHash<QString, Item>::iterator iter = shard.m_items.begin(); iter != shard.m_items.end();)
+        {
+            if (iter.key().startsWith(prefix) && iter.key().indexOf('/', prefix.size()) < 0)
+            {
+                removed.push_back(iter.key());
+                iter = erase(shard, iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        if (removed.size() > removedCount)
+        {
+            invalidate(shard);
+        }
+        shard.m_lock.unlock();
+    }
+
+    return removed;
+}
+
+QHash<QString, StaticFileCache::Item>::iterator StaticFileCache::erase(Shard &shard, QHash<QString, Item>::iterator iter)
+{
+    shard.m_costInKB -= iter.value()->m_costInKB;
+    if (iter.value()->m_inWindow)
+    {
+        shard.m_windowCostInKB -= iter.value()->m_costInKB;
+    }
+    segmentOf(shard, iter.value().data()).unlink(iter.value().data());
+    return shard.m_items.erase(iter);
+}
+
+void StaticFileCache::invalidate(Shard &shard)
+{
+    // called with the shard locked for write, the shard first, a worker seeing the global bump then sees both
+    shard.m_generation.fetchAndAddRelease(1);
+    m_generation.fetchAndAddRelease(1);
+}
+
+bool StaticFileCache::isMoreFrequent(const StaticFileServer::FileCacheItem *candidate, const StaticFileServer::FileCacheItem *incumbent)
+{
+    uint candidateHash = qHash(candidate->m_cacheKey);
+    uint incumbentHash = qHash(incumbent->m_cacheKey);
+
+    QMutexLocker locker(&m_sketchMutex);
+    return m_sketch.frequency(candidateHash) > m_sketch.frequency(incumbentHash);
+}
+
+void StaticFileCache::evict(Shard &shard)
+{
+    // called with the shard locked for write
+    qint64 capacity = m_shardCapacityInKB.load();
+    qint64 windowCapacity = qMax<qint64>(capacity / 100, 1);
+    bool evicted = false;
+
+    while (shard.m_costInKB > capacity && !shard.m_items.isEmpty())
+    {
+        StaticFileServer::FileCacheItem *windowVictim = shard.m_window.coldest();
+        StaticFileServer::FileCacheItem *mainVictim = shard.m_main.coldest();
+        StaticFileServer::FileCacheItem *victim;
+
+        if (!windowVictim)
+        {
+            victim = mainVictim;
+        }
+        else if (!mainVictim)
+        {
+            victim = windowVictim;
+        }
+        else if (shard.m_windowCostInKB > windowCapacity)
+        {
+            // the item leaving the window competes with the one main would give up for it, ties keep the incumbent
+            victim = isMoreFrequent(windowVictim, mainVictim) ? mainVictim : windowVictim;
+        }
+        else
+        {
+            // the window is within its share, main is over its own, e.g. after the capacity was lowered
+            victim = mainVictim;
+        }
+
+        erase(shard, shard.m_items.find(victim->m_cacheKey));
+        m_evictions.fetchAndAddRelaxed(1);
+        evicted = true;
+    }
+
+    // what still overflows the window has been admitted, there is room for it in main now, oldest first
+    while (shard.m_windowCostInKB > windowCapacity)
+    {
+        StaticFileServer::FileCacheItem *item = shard.m_window.coldest();
+
+        shard.m_window.unlink(item);
+        item->m_inWindow = false;
+        shard.m_windowCostInKB -= item->m_costInKB;
+        shard.m_main.pushFront(item);
+    }
+
+    if (evicted)
+    {
+        invalidate(shard);
+    }
+}
+
+void StaticFileCache::Segment::pushFront(StaticFileServer::FileCacheItem *item)
+{
+    item->m_previous = nullptr;
+    item->m_next = m_head;
+    if (m_head)
+    {
+        m_head->m_previous = item;
+    }
+    else
+    {
+        m_tail = item;
+    }
+    m_head = item;
+    ++m_size;
+}
+
+void StaticFileCache::Segment::unlink(StaticFileServer::FileCacheItem *item)
+{
+    if (item->m_previous)
+    {
+        item->m_previous->m_next = item->m_next;
+    }
+    else
+    {
+        m_head = item->m_next;
+    }
+    if (item->m_next)
+    {
+        item->m_next->m_previous = item->m_previous;
+    }
+    else
+    {
+        m_tail = item->m_previous;
+    }
+    item->m_previous = nullptr;
+    item->m_next = nullptr;
+    --m_size;
+}
+
+StaticFileServer::FileCacheItem *StaticFileCache::Segment::coldest()
+{
+    // hits only update m_lastAccess, an item used since it was queued goes back to the front instead of out,
+    // a full turn of the list at most, by then every item has been moved once
+    for(int i = 0; i < m_size; ++i)
+    {
+        StaticFileServer::FileCacheItem *item = m_tail;
+        qint64 lastAccess = item->m_lastAccess.load();
+
+        if (lastAccess <= item->m_queuedAt)
+        {
+            return item;
+        }
+
+        unlink(item);
+        item->m_queuedAt = lastAccess;
+        pushFront(item);
+    }
+
+    return m_tail;
+}
@@ -0,0 +1,277 @@
+#ifndef STATICFILECACHE_H
+#define STATICFILECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QSharedPointer>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+#include <QVector>
+#include <QStringList>
+#include <QMutex>
+#include "StaticFileServer.h"
+#include "FrequencySketch.h"
+
+/*! \brief StaticFileCache is the file content cache shared by all StaticFileServers
+ *
+ * The cache is split into shards, each guarded by its own read write lock, so workers looking up different files
+ * don't contend, and hits on the same file only take a shared lock. Items are immutable once inserted and handed out
+ * as reference counted pointers, a hit copies a pointer, not the content, and the lock is released before the
+ * caller touches the item. Entries are keyed by canonical file path.
+ *
+ * Each shard follows W-TinyLFU. New items enter a small admission window, about 1% of the shard, evicted least
+ * recently used. An item leaving the window only enters the main part of the shard if it has been requested more
+ * often than the least recently used main item it would displace, according to a FrequencySketch of recent lookups.
+ * A crawler walking thousands of files once each then churns the window and leaves the hot files alone. Both parts
+ * keep their items in an LRU list, reordered lazily at eviction time, hits don't take the write lock.
+ *
+ * In front of the shards, each worker thread has a small direct mapped L1 cache of pointers to the shared items.
+ * L1 slots are valid as long as the generation of their shard hasn't changed since they were filled, a shard's
+ * generation is bumped whenever an item leaves it. A hot file is then served without writing to any cache line
+ * shared with other workers. Stale slots are emptied on the worker's next lookup, so that they don't keep evicted
+ * items alive.
+ */
+class StaticFileCache
+{
+public:
+    typedef QSharedPointer<StaticFileServer::FileCacheItem> Item;
+
+    //! \brief Statistics counts the lookups of one worker thread
+    class alignas(64) Statistics
+    {
+    public:
+        QString m_threadName;
+        QAtomicInteger<quint64> m_l1Hits;
+        QAtomicInteger<quint64> m_l2Hits;
+        QAtomicInteger<quint64> m_misses;
+        // full responses sent from the cache, and what compression saved on them
+        QAtomicInteger<quint64> m_bytesSent;
+        QAtomicInteger<quint64> m_bytesSaved;
+
+        Statistics(const QString &threadName)
+            :m_threadName(threadName),
+              m_l1Hits(0),
+              m_l2Hits(0),
+              m_misses(0),
+              m_bytesSent(0),
+              m_bytesSaved(0)
+        {}
+    };
+
+    //! \brief Usage is a snapshot of what the shared shards hold
+    class Usage
+    {
+    public:
+        int m_entries;
+        qint64 m_costInKB;
+
+        Usage()
+            :m_entries(0),
+              m_costInKB(0)
+        {}
+    };
+
+private:
+    class LocalCache
+    {
+    public:
+        class Slot
+        {
+        public:
+            QString m_canonicalPath;
+            Item m_item;
+            quint64 m_generation;
+
+            Slot()
+                :m_canonicalPath(),
+                  m_item(),
+                  m_generation(0)
+            {}
+        };
+
+        static const int m_slotCount = 256;
+        Slot m_slots[m_slotCount];
+        // the global generation the slots were last checked against, see release()
+        quint64 m_checkedGeneration;
+        // the flush generation the slots were last emptied at
+        quint64 m_flushedGeneration;
+        Statistics *m_statistics;
+
+        // hashes of the paths looked up, recorded in the sketch in batches
+        static const int m_accessBufferSize = 64;
+        uint m_accesses[m_accessBufferSize];
+        int m_accessCount;
+
+        LocalCache();
+    };
+
+    //! \brief Segment is an intrusive LRU list of items, the admission window or the main part of a shard
+    class Segment
+    {
+    public:
+        StaticFileServer::FileCacheItem *m_head;
+        StaticFileServer::FileCacheItem *m_tail;
+        int m_size;
+
+        Segment()
+            :m_head(nullptr),
+              m_tail(nullptr),
+              m_size(0)
+        {}
+
+        void pushFront(StaticFileServer::FileCacheItem *item);
+        void unlink(StaticFileServer::FileCacheItem *item);
+
+        //! \brief coldest returns the least recently used item, null if the list is empty
+        StaticFileServer::FileCacheItem *coldest();
+    };
+
+    // one shard per cache line, and its generation on a line of its own: every L1 hit reads the generation, it must
+    // not be invalidated by writers taking the lock or updating the LRU lists
+    class alignas(64) Shard
+    {
+    public:
+        QReadWriteLock m_lock;
+        QHash<QString, Item> m_items;
+        qint64 m_costInKB;
+        qint64 m_windowCostInKB;
+        Segment m_window;
+        Segment m_main;
+        // bumped whenever an item is removed, replaced or evicted, invalidates the L1 slots of the shard
+        alignas(64) QAtomicInteger<quint64> m_generation;
+
+        Shard()
+            :m_lock(),
+              m_items(),
+              m_costInKB(0),
+              m_windowCostInKB(0),
+              m_window(),
+              m_main(),
+              m_generation(1)
+        {}
+    };
+
+    static const int m_shardCount = 64;
+    Shard m_shards[m_shardCount];
+    // the configured size, the capacity is lowered below it under memory pressure
+    QAtomicInteger<qint64> m_budgetInKB;
+    QAtomicInteger<qint64> m_shardCapacityInKB;
+    QAtomicInteger<quint64> m_evictions;
+    // bumped after a shard's generation, tells the workers to check their L1 slots
+    QAtomicInteger<quint64> m_generation;
+    // bumped when the capacity is lowered, tells the workers to empty their L1 slots
+    QAtomicInteger<quint64> m_flushGeneration;
+    const Item m_nullItem;
+
+    QMutex m_sketchMutex;
+    FrequencySketch m_sketch;
+
+    QMutex m_statisticsMutex;
+    // owned here rather than by the threads, so that they can be reported after a worker exits
+    QVector<Statistics*> m_statistics;
+
+    StaticFileCache();
+
+    Shard & shardFor(const QString &canonicalPath)
+    {
+        return m_shards[qHash(canonicalPath) % m_shardCount];
+    }
+
+    Segment & segmentOf(Shard &shard, const StaticFileServer::FileCacheItem *item)
+    {
+        return item->m_inWindow ? shard.m_window : shard.m_main;
+    }
+
+    void invalidate(Shard &shard);
+    void evict(Shard &shard);
+    bool isMoreFrequent(const StaticFileServer::FileCacheItem *candidate, const StaticFileServer::FileCacheItem *incumbent);
+    QHash<QString, Item>::iterator erase(Shard &shard, QHash<QString, Item>::iterator iter);
+    void recordAccess(LocalCache &local, uint hash);
+    void release(LocalCache &local);
+    void flush(LocalCache &local);
+    Item findShared(const QString &canonicalPath);
+    LocalCache &localCache();
+    Statistics *registerStatistics();
+
+public:
+    static StaticFileCache &getSingleton();
+
+    /*!
+     * \brief find looks up a cached file, in the calling thread's L1 cache first, then in the shared shards
+     * \param[in] canonicalPath the canonical path of the file
+     * \return the cached item, null on a miss
+     *
+     * The returned reference points into the calling thread's L1 cache, it is only valid until the next find() on
+     * the same thread. Copy it to keep the item.
+     */
+    const Item & find(const QString &canonicalPath);
+
+    /*!
+     * \brief insert adds a file to the cache, replacing the previous item of the same path
+     * \param[in] canonicalPath the canonical path of the file
+     * \param[in] item the item, it must not be modified afterwards
+     */
+    void insert(const QString &canonicalPath, const Item &item);
+
+    //! \brief contains checks the shared shards only, for background threads that have no use for an L1 cache
+    bool contains(const QString &canonicalPath)
+    {
+        return !findShared(canonicalPath).isNull();
+    }
+
+    void remove(const QString &canonicalPath);
+
+    /*!
+     * \brief removeDirectory removes the files directly in a directory, not those of its subdirectories
+     * \param[in] canonicalDirectoryPath the canonical path of the directory, without trailing slash
+     * \return the canonical paths of the removed files
+     */
+    QStringList removeDirectory(const QString &canonicalDirectoryPath);
+
+    /*!
+     * \brief addCost accounts for memory an item gained after insertion, e.g. a compressed variant
+     * \param[in] canonicalPath the canonical path of the file
+     * \param[in] item the item that grew, nothing is done if it is no longer the cached one
+     * \param[in] costInKB the additional size
+     */
+    void addCost(const QString &canonicalPath, const Item &item, qint64 costInKB);
+
+    //! \brief admits tells if a file of this size can be cached at all, larger ones are served from disk
+    bool admits(qint64 sizeInBytes) const
+    {
+        return qMax<qint64>(sizeInBytes / 1024, 1) <= m_shardCapacityInKB.load();
+    }
+
+    qint64 capacityInKB() const
+    {
+        return m_shardCapacityInKB.load() * m_shardCount;
+    }
+
+    qint64 budgetInKB() const
+    {
+        return m_budgetInKB.load();
+    }
+
+    /*!
+     * \brief setCapacityInKB resizes the cache, evicting right away what no longer fits
+     *
+     * Used by MemoryPressureMonitor, the budget itself comes from the StaticFileCache/budgetMB setting. When shrinking,
+     * the workers also drop every L1 reference on their next lookup, evicted items are freed once they have.
+     */
+    void setCapacityInKB(qint64 capacityInKB);
+
+    //! \brief recordTransfer counts a full response sent from the cache, for the calling thread's statistics
+    void recordTransfer(qint64 identitySize, qint64 sentSize);
+
+    Usage usage();
+
+    quint64 evictions() const
+    {
+        return m_evictions.load();
+    }
+
+    //! \brief statistics returns the lookup counters of every thread that has used the cache
+    QVector<const Statistics*> statistics();
+};
+
+#endif // STATICFILECACHE_H
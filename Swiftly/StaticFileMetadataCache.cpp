@@ -0,0 +1,81 @@
+#include "StaticFileMetadataCache.h"
+
+StaticFileMetadataCache::StaticFileMetadataCache()
+    :m_generation(1)
+{
+}
+
+StaticFileMetadataCache::LocalCache &StaticFileMetadataCache::localCache()
+{
+    static thread_local LocalCache localCache;
+
+    quint64 generation = m_generation.loadAcquire();
+
+    if (localCache.m_generation != generation)
+    {
+        localCache.m_found.clear();
+        localCache.m_missing.clear();
+        localCache.m_generation = generation;
+    }
+
+    return localCache;
+}
+
+StaticFileMetadataCache::State StaticFileMetadataCache::find(const QString &absolutePath, Metadata &metadata)
+{
+    LocalCache &local = localCache();
+
+    QHash<QString, Metadata>::ConstIterator found = local.m_found.constFind(absolutePath);
+
+    if (found != local.m_found.constEnd())
+    {
+        if (found->m_expiresAt == 0 || found->m_expiresAt > QDateTime::currentMSecsSinceEpoch())
+        {
+            metadata = found.value();
+            return State::Found;
+        }
+
+        local.m_found.remove(absolutePath);
+        return State::Unknown;
+    }
+
+    QHash<QString, qint64>::ConstIterator missing = local.m_missing.constFind(absolutePath);
+
+    if (missing != local.m_missing.constEnd())
+    {
+        if (missing.value() > QDateTime::currentMSecsSinceEpoch())
+        {
+            return State::Missing;
+        }
+
+        local.m_missing.remove(absolutePath);
+    }
+
+    return State::Unknown;
+}
+
+void StaticFileMetadataCache::insert(const QString &absolutePath, const Metadata &metadata)
+{
+    LocalCache &local = localCache();
+
+    // a full table starts over, entries are cheap to resolve again and the hot ones come back first
+    if (local.m_found.size() >= m_maximumFoundCount)
+    {
+        local.m_found.clear();
+    }
+
+    local.m_found.insert(absolutePath, metadata);
+}
+
+void StaticFileMetadataCache::insertMissing(const QString &absolutePath)
+{
+    LocalCache &local = localCache();
+
+    // kept apart from the files found, so that a scan doesn't push out the hot entries
+    if (local.m_missing.size() >= m_maximumMissingCount)
+    {
+        local.m_missing.clear();
+    }
+
+    local.m_missing.insert(absolutePath, QDateTime::currentMSecsSinceEpoch() + m_ttlInMilliseconds);
+}
@@ -0,0 +1,99 @@
+#ifndef STATICFILEMETADATACACHE_H
+#define STATICFILEMETADATACACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QDateTime>
+#include <QAtomicInteger>
+
+/*! \brief StaticFileMetadataCache remembers what a requested path resolves to
+ *
+ * Resolving a path costs a realpath and a stat. Each worker thread keeps its own bounded table from absolute request
+ * path to canonical path, size and modification time, so a hit costs no syscall and touches no shared cache line.
+ * Paths that don't resolve to a file are remembered for a short while too, scanners probing for files that don't
+ * exist then cost nothing either.
+ *
+ * Entries are dropped everywhere at once when invalidate() bumps the generation counter, StaticFileWatcher does so
+ * whenever a watched directory changes. Entries of roots that aren't watched expire after a short time instead.
+ */
+class StaticFileMetadataCache
+{
+public:
+    class Metadata
+    {
+    public:
+        QString m_canonicalPath;
+        qint64 m_size;
+        QDateTime m_lastModified;
+        // in ms since epoch, 0 if the entry only goes away on invalidate()
+        qint64 m_expiresAt;
+
+        Metadata()
+            :m_canonicalPath(),
+              m_size(0),
+              m_lastModified(),
+              m_expiresAt(0)
+        {}
+    };
+
+    enum class State
+    {
+        Found,
+        Missing,
+        Unknown
+    };
+
+    //! how long an entry lives when its root isn't watched, and a missing path in any case
+    static const qint64 m_ttlInMilliseconds = 2000;
+
+private:
+    class LocalCache
+    {
+    public:
+        QHash<QString, Metadata> m_found;
+        // expiry of each missing path
+        QHash<QString, qint64> m_missing;
+        quint64 m_generation;
+
+        LocalCache()
+            :m_found(),
+              m_missing(),
+              m_generation(0)
+        {}
+    };
+
+    static const int m_maximumFoundCount = 4096;
+    static const int m_maximumMissingCount = 1024;
+
+    QAtomicInteger<quint64> m_generation;
+
+    StaticFileMetadataCache();
+    LocalCache &localCache();
+
+public:
+    static StaticFileMetadataCache &getSingleton()
+    {
+        static StaticFileMetadataCache obj;
+        return obj;
+    }
+
+    /*!
+     * \brief find looks up a path in the calling thread's table
+     * \param[in] absolutePath the absolute, not canonical, path of the request
+     * \param[out] metadata the file's metadata, if found
+     * \return Unknown if the path has to be resolved
+     */
+    State find(const QString &absolutePath, Metadata &metadata);
+
+    void insert(const QString &absolutePath, const Metadata &metadata);
+
+    void insertMissing(const QString &absolutePath);
+
+    //! \brief invalidate drops every entry of every thread
+    void invalidate()
+    {
+        m_generation.fetchAndAddRelease(1);
+    }
+};
+
+#endif // STATICFILEMETADATACACHE_H
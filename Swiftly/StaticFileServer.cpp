@@ -1,10 +1,22 @@
 #include "StaticFileServer.h"
 #include <QFile>
 #include <QDebug>
-#include <unistd.h>
-#include <QDataStream>
-#include <QCryptographicHash>
 #include <QStringBuilder>
+#include "Compression.h"
+#include "Checksum.h"
+#include "StaticFileCache.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include <QRunnable>
+#include <QThreadPool>
+#include <QUuid>
+#include <QDirIterator>
+#include "StaticFileWatcher.h"
+#include "StaticBundle.h"
+#include "StaticFileArtifactCache.h"
+#include "AssetManifest.h"
+#include <algorithm>
+#include <sys/stat.h>
 
 //based on
 //https://developer.mozilla.org/en-US/docs/Web/HTTP/Basics_of_HTTP/MIME_types
@@ -30,427 +42,1348 @@ QHash<QString, QString> StaticFileServer::m_mimeTypeMap =
  {"xml" , "application/xml"},
  {"pdf" , "application/pdf"}};
 
-unsigned long long getAvailableSystemMemory()
-{
-    long pages = sysconf(_SC_AVPHYS_PAGES);
-    long page_size = sysconf(_SC_PAGE_SIZE);
-    unsigned long long avilableMem = pages * page_size;
-    qDebug() << "Available Memory in MB: " << avilableMem / 1024 / 1024;
-    return avilableMem ;
-}
-
-QMutex StaticFileServer::m_fileCacheMutex;
-QCache<QString, StaticFileServer::FileCacheItem > StaticFileServer::m_fileCache(getAvailableSystemMemory() / 2048);
-
-
-static const quint32 crc_32_tab[] = { /* CRC polynomial 0xedb88320 */
-    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
+StaticFileServer::FileCacheItem::FileCacheItem(const QFileInfo &fileInfo, const QByteArray &fileContent, const FileType fileType, const QString &mimeType, const QString &etag)
+    :m_fileInfo(fileInfo),
+      m_lastModified(fileInfo.lastModified()),
+      m_fileContent(fileContent),
+      m_variants(),
+      m_fileType(fileType),
+      m_mimeType(mimeType),
+      m_etag(etag),
+      m_varies(false),
+      m_artifactKey(),
+      m_costInKB(0),
+      m_lastAccess(0),
+      m_inWindow(true),
+      m_cacheKey(),
+      m_previous(nullptr),
+      m_next(nullptr),
+      m_queuedAt(0)
+{
+    m_variants[static_cast<int>(ContentEncoding::Identity)].m_content = fileContent;
+    m_variants[static_cast<int>(ContentEncoding::Identity)].m_state.store(VariantReady);
+
+    bool worthCompressing = isWorthCompressing(mimeType, fileContent.size());
+
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        if (worthCompressing && isContentEncodingSupported(static_cast<ContentEncoding>(i)))
+        {
+            m_variants[i].m_state.store(VariantPending);
+        }
+    }
+
+    m_varies = hasVariants();
+    prepareHeader(ContentEncoding::Identity);
+}
+
+unsigned int StaticFileServer::FileCacheItem::sizeInKB() const
+{
+    int size = m_fileContent.size();
+
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        if (isVariantReady(static_cast<ContentEncoding>(i)))
+        {
+            size += m_variants[i].m_content.size();
+        }
+    }
+
+    return size / 1024;
+}
+
+void StaticFileServer::FileCacheItem::loadSidecars()
+{
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        ContentEncoding encoding = static_cast<ContentEncoding>(i);
+        QFileInfo sidecarInfo(m_fileInfo.absoluteFilePath() % contentEncodingSuffix(encoding));
+
+        if (!sidecarInfo.isFile() || sidecarInfo.lastModified() < m_lastModified)
+        {
+            continue;
+        }
+
+        QFile sidecar(sidecarInfo.absoluteFilePath());
+
+        if (sidecar.open(QFile::ReadOnly))
+        {
+            // serving a precompressed sidecar doesn't need the encoder, even unsupported encodings are usable
+            setVariant(encoding, sidecar.readAll());
+        }
+    }
+
+    // a sidecar may exist for a file too small to be worth compressing, the identity response then varies as well
+    if (!m_varies && hasVariants())
+    {
+        m_varies = true;
+        prepareHeader(ContentEncoding::Identity);
+    }
+}
+
+bool StaticFileServer::FileCacheItem::claimVariant(ContentEncoding encoding)
+{
+    QAtomicInt &state = m_variants[static_cast<int>(encoding)].m_state;
+
+    return state.loadAcquire() == VariantPending && state.testAndSetOrdered(VariantPending, VariantCompressing);
+}
+
+void StaticFileServer::FileCacheItem::setVariant(ContentEncoding encoding, const QByteArray &content)
+{
+    Variant &variant = m_variants[static_cast<int>(encoding)];
+
+    if (content.isEmpty() || content.size() >= m_fileContent.size())
+    {
+        variant.m_state.storeRelease(VariantUseless);
+        return;
+    }
+
+    variant.m_content = content;
+    prepareHeader(encoding);
+    variant.m_state.storeRelease(VariantReady);
+}
 
-quint32 updateCRC32(unsigned char ch, quint32 crc)
+bool StaticFileServer::FileCacheItem::hasVariants() const
 {
-    return (crc_32_tab[((crc) ^ ((quint8)ch)) & 0xff] ^ ((crc) >> 8));
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        if (m_variants[i].m_state.loadAcquire() != VariantUseless)
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
-quint32 crc32buf(const QByteArray& data)
+QString StaticFileServer::FileCacheItem::etag(ContentEncoding encoding) const
 {
-    return ~std::accumulate(
-        data.begin(),
-        data.end(),
-        quint32(0xFFFFFFFF),
-        [](quint32 oldcrc32, char buf){ return updateCRC32(buf, oldcrc32); });
+    return variantETag(m_etag, encoding);
 }
 
-static QByteArray compress(const QByteArray& data)
+void StaticFileServer::FileCacheItem::prepareHeader(ContentEncoding encoding)
 {
-    auto compressedData = qCompress(data);
-    //  Strip the first six bytes (a 4-byte length put on by qCompress and a 2-byte zlib header)
-    // and the last four bytes (a zlib integrity check).
-    compressedData.remove(0, 6);
-    compressedData.chop(4);
+    Variant &variant = m_variants[static_cast<int>(encoding)];
+    variant.m_preparedHeader = StaticFileServer::prepareHeader(variant.m_content.size(), m_mimeType, encoding, etag(encoding),
+                                                               m_lastModified, m_varies || encoding != ContentEncoding::Identity);
+}
 
-    QByteArray header;
-    QDataStream ds1(&header, QIODevice::WriteOnly);
-    // Prepend a generic 10-byte gzip header (see RFC 1952),
-    ds1 << quint16(0x1f8b)
-        << quint16(0x0800)
-        << quint16(0x0000)
-        << quint16(0x0000)
-        << quint16(0x000b);
+QString StaticFileServer::variantETag(const QString &etag, ContentEncoding encoding)
+{
+    QString result = etag;
 
-    // Append a four-byte CRC-32 of the uncompressed data
-    // Append 4 bytes uncompressed input size modulo 2^32
-    QByteArray footer;
-    QDataStream ds2(&footer, QIODevice::WriteOnly);
-    ds2.setByteOrder(QDataStream::LittleEndian);
-    ds2 << crc32buf(data)
-        << quint32(data.size());
+    if (encoding != ContentEncoding::Identity && !result.isEmpty())
+    {
+        result.insert(result.size() - 1, "-" % contentEncodingName(encoding));
+    }
 
-    return header + compressedData + footer;
+    return result;
 }
 
-StaticFileServer::FileCacheItem::FileCacheItem(const QFileInfo &fileInfo, const QByteArray &fileContent, const FileType fileType, const QString &mimeType)
-    :m_fileInfo(fileInfo),
-      m_fileContent(fileContent),
-      m_fileGZipContent(),
-      m_fileType(fileType),
-      m_mimeType(mimeType),
-      m_md5()
+QByteArray StaticFileServer::prepareHeader(qint64 contentLength, const QString &mimeType, ContentEncoding encoding,
+                                           const QString &etag, const QDateTime &lastModified, bool varies)
 {
-    m_fileGZipContent = compress(fileContent);
-    m_md5 = QString("\"") % QCryptographicHash::hash(fileContent, QCryptographicHash::Md5).toHex() % "\"";
+    // the same fields serve() sets when it builds a response field by field
+    HttpHeader header;
+
+    header.setCurrentHeaderField("Accept-Ranges");
+    header.addHeaderInfo(QSharedPointer<QString>(new QString("bytes")));
+
+    if (encoding != ContentEncoding::Identity)
+    {
+        header.setCurrentHeaderField("Content-Encoding");
+        header.addHeaderInfo(QSharedPointer<QString>(new QString(contentEncodingName(encoding))));
+    }
+
+    if (varies)
+    {
+        header.setCurrentHeaderField("Vary");
+        header.addHeaderInfo(QSharedPointer<QString>(new QString("Accept-Encoding")));
+    }
+
+    if (!etag.isEmpty())
+    {
+        header.setCurrentHeaderField("ETag");
+        header.addHeaderInfo(QSharedPointer<QString>(new QString(etag)));
+    }
+
+    header.setCurrentHeaderField("Last-Modified");
+    header.addHeaderInfo(QSharedPointer<QString>(new QString(HttpHeader::toHttpDate(lastModified))));
+
+    return HttpResponse::prepareHeader(contentLength, mimeType, header);
 }
 
-unsigned int StaticFileServer::FileCacheItem::sizeInKB()
+// compresses a claimed variant, unless it has been compressed before, by this or an earlier run of the server
+static void produceVariant(const StaticFileCache::Item &item, ContentEncoding encoding)
 {
-    return (m_fileContent.size() + m_fileGZipContent.size()) / 1024;
+    const StaticFileArtifactCache &artifacts = StaticFileArtifactCache::getSingleton();
+    QByteArray content;
+
+    if (!artifacts.loadVariant(item->m_artifactKey, encoding, content))
+    {
+        content = compressContent(item->m_fileContent, encoding);
+        artifacts.storeVariant(item->m_artifactKey, encoding, content.size() < item->m_fileContent.size() ? content : QByteArray());
+    }
+
+    item->setVariant(encoding, content);
 }
 
+/*! \brief CompressionTask produces a variant of a cached file on the global thread pool
+ *
+ * Compression runs once, at the highest level, off the worker that first asked for it. The item is charged for the
+ * extra memory only if the variant is kept.
+ */
+class CompressionTask : public QRunnable
+{
+private:
+    QString m_canonicalPath;
+    StaticFileCache::Item m_item;
+    ContentEncoding m_encoding;
+
+public:
+    CompressionTask(const QString &canonicalPath, const StaticFileCache::Item &item, ContentEncoding encoding)
+        :QRunnable(),
+          m_canonicalPath(canonicalPath),
+          m_item(item),
+          m_encoding(encoding)
+    {}
+
+    void run() override
+    {
+        produceVariant(m_item, m_encoding);
+
+        if (m_item->isVariantReady(m_encoding))
+        {
+            StaticFileCache::getSingleton().addCost(m_canonicalPath, m_item, m_item->variant(m_encoding).size() / 1024);
+        }
+    }
+};
+
+/*! \brief PrewarmTask reads files into the cache on the global thread pool, the whole root if no path is given
+ */
+class PrewarmTask : public QRunnable
+{
+private:
+    StaticFileServer m_server;
+    QStringList m_canonicalPaths;
+
+public:
+    PrewarmTask(const StaticFileServer &server, const QStringList &canonicalPaths)
+        :QRunnable(),
+          m_server(server),
+          m_canonicalPaths(canonicalPaths)
+    {}
+
+    void run() override
+    {
+        m_server.prewarmFiles(m_canonicalPaths);
+    }
+};
+
+class AssetFingerprintTask : public QRunnable
+{
+private:
+    StaticFileServer m_server;
+    QStringList m_canonicalPaths;
+
+public:
+    AssetFingerprintTask(const StaticFileServer &server, const QStringList &canonicalPaths)
+        :QRunnable(),
+          m_server(server),
+          m_canonicalPaths(canonicalPaths)
+    {}
+
+    void run() override
+    {
+        m_server.fingerprintFiles(m_canonicalPaths);
+    }
+};
+
 StaticFileServer::StaticFileServer(const QDir &rootPath)
     :QObject(),
-      m_rootDir(rootPath)
+      m_rootDir(rootPath),
+      m_rootAbsolutePath(),
+      m_rootCanonicalPath(),
+      m_etagMode(ETagMode::ContentHash),
+      m_watched(false),
+      m_bundle(),
+      m_assetManifest()
 {
     if (!m_rootDir.exists())
     {
         m_rootDir = QDir(".");
     }
-    qDebug() << m_rootDir.canonicalPath();
 
+    m_rootAbsolutePath = m_rootDir.absolutePath();
+    m_rootCanonicalPath = m_rootDir.canonicalPath();
+
+    qDebug() << m_rootCanonicalPath;
 }
 
 StaticFileServer::StaticFileServer(const StaticFileServer &in)
     :QObject(),
-      m_rootDir(in.m_rootDir)
+      m_rootDir(in.m_rootDir),
+      m_rootAbsolutePath(in.m_rootAbsolutePath),
+      m_rootCanonicalPath(in.m_rootCanonicalPath),
+      m_etagMode(in.m_etagMode),
+      m_watched(in.m_watched),
+      m_bundle(in.m_bundle),
+      m_assetManifest(in.m_assetManifest)
 {
-    if (!m_rootDir.exists())
-    {
-        m_rootDir = QDir(".");
-    }
 }
 
-bool StaticFileServer::getFileByPath(const QString &path, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress) const
+QString StaticFileServer::mimeTypeForSuffix(const QString &suffix)
 {
-    QString filePath = m_rootDir.absolutePath().append(path);
+    return m_mimeTypeMap.value(suffix);
+}
 
-    QFileInfo fileInfo(filePath);
+// more ranges than this aren't worth a multipart answer, the whole file is sent instead
+static const int maximumRangeCount = 16;
 
-    qDebug() << fileInfo.canonicalFilePath() << fileInfo.absoluteFilePath();
+// a multipart answer is assembled in the heap, larger ones are sent as the whole file, from its mapping if it has one
+static const qint64 maximumMultipartSize = 4 * 1024 * 1024;
 
-    if (!fileInfo.isFile())
+/*!
+ * \brief parseByteRanges parses a "bytes=" Range header (RFC 7233, 2.1) against a representation's size
+ * \param[out] ranges the satisfiable ranges, sorted, adjacent ones merged, as inclusive [first, last] pairs. Empty if
+ * none is satisfiable.
+ * \return false if the header should be ignored, it isn't a byte range set, asks for too many ranges, or for
+ * overlapping ones (RFC 7233, 6.1)
+ */
+static bool parseByteRanges(const QString &rangeHeader, qint64 size, QVector<QPair<qint64, qint64>> &ranges)
+{
+    if (!rangeHeader.startsWith("bytes="))
     {
         return false;
     }
 
-    if (!fileInfo.exists())
-    {
-        return false;
-    }
+    QVector<QStringRef> specs = rangeHeader.midRef(6).split(',', QString::SkipEmptyParts);
 
-    if (fileInfo.canonicalFilePath().left(m_rootDir.canonicalPath().size()) != m_rootDir.canonicalPath())
+    if (specs.isEmpty() || specs.size() > maximumRangeCount)
     {
         return false;
     }
 
-    if (useCache)
+    for(int i = 0; i < specs.size(); ++i)
     {
-        StaticFileServer::m_fileCacheMutex.lock();
+        QStringRef spec = specs[i].trimmed();
+        int dash = spec.indexOf('-');
 
-        if (!StaticFileServer::m_fileCache.contains(fileInfo.canonicalFilePath()))
+        if (dash < 0)
         {
-            m_fileCacheMutex.unlock();
-
-            QFile file(fileInfo.canonicalFilePath());
-            if (file.open(QFile::ReadOnly))
-            {
-                fileContent = file.readAll();
-                file.close();
-            }
-
-            if(m_mimeTypeMap.contains(fileInfo.suffix()))
-            {
-                mimeType = m_mimeTypeMap[fileInfo.suffix()];
-            }
-            else
-            {
-                StaticFileServer::FileType fileType = fileTypeHint;
-
-                if (fileType == StaticFileServer::FileType::UNSPECIFIED)
-                {
-                    fileType = guessFileType(fileContent);
-                }
+            return false;
+        }
 
-                if (fileType == StaticFileServer::FileType::TEXT)
-                {
-                    mimeType = "text/plain";
-                }
-                else if(fileType == StaticFileServer::FileType::BINARY)
-                {
-                    mimeType = "application/octet-stream";
-                }
-                else
-                {
-                    return false;
-                }
-            }
+        QStringRef firstRef = spec.left(dash).trimmed();
+        QStringRef lastRef = spec.mid(dash + 1).trimmed();
+        bool ok = false;
+        qint64 first = 0;
+        qint64 last = size - 1;
 
-            FileCacheItem *item = new FileCacheItem(fileInfo, fileContent, StaticFileServer::FileType::UNSPECIFIED, mimeType);
-            qint64 sizeInKB = item->sizeInKB();
+        if (firstRef.isEmpty())
+        {
+            // "-500" is the last 500 bytes
+            qint64 suffixLength = lastRef.toLongLong(&ok);
 
-            if (sizeInKB < 1)
+            if (!ok || suffixLength < 0)
             {
-                sizeInKB = 1;
+                return false;
             }
 
-            StaticFileServer::m_fileCacheMutex.lock();
-
-            StaticFileServer::m_fileCache.insert(fileInfo.absoluteFilePath(), item, (int) sizeInKB);
-            qDebug() << "file" << fileInfo.absoluteFilePath() << "is in cache" << sizeInKB;
+            first = qMax<qint64>(size - suffixLength, 0);
 
-            StaticFileServer::m_fileCacheMutex.unlock();
-
-            if (compress)
+            if (suffixLength == 0)
             {
-                fileContent = item->m_fileGZipContent;
+                continue;
             }
-
-            md5 = item->m_md5;
         }
         else
         {
-            FileCacheItem *item = StaticFileServer::m_fileCache[fileInfo.absoluteFilePath()];
+            first = firstRef.toLongLong(&ok);
 
-            if (compress)
+            if (!ok || first < 0)
             {
-                fileContent = item->m_fileGZipContent;
+                return false;
             }
-            else
+
+            if (!lastRef.isEmpty())
             {
-                fileContent = item->m_fileContent;
+                last = lastRef.toLongLong(&ok);
+
+                if (!ok || last < first)
+                {
+                    return false;
+                }
+
+                last = qMin(last, size - 1);
             }
-            mimeType = item->m_mimeType;
-            qDebug() << "file" << item->m_fileInfo.absoluteFilePath() << "is from cache";
-            md5 = item->m_md5;
-            StaticFileServer::m_fileCacheMutex.unlock();
+        }
+
+        if (first < size)
+        {
+            ranges.push_back(qMakePair(first, last));
         }
     }
-    else
+
+    std::sort(ranges.begin(), ranges.end());
+
+    QVector<QPair<qint64, qint64>> merged;
+
+    for(int i = 0; i < ranges.size(); ++i)
     {
-        QFile file(fileInfo.canonicalFilePath());
-        if (file.open(QFile::ReadOnly))
+        // a client asking for the same bytes several times gets them once, in a 200
+        if (!merged.isEmpty() && ranges[i].first <= merged.last().second)
         {
-            fileContent = file.readAll();
-            file.close();
+            return false;
         }
 
-        if(m_mimeTypeMap.contains(fileInfo.suffix()))
+        if (!merged.isEmpty() && ranges[i].first == merged.last().second + 1)
         {
-            mimeType = m_mimeTypeMap[fileInfo.suffix()];
+            merged.last().second = ranges[i].second;
         }
         else
         {
-            StaticFileServer::FileType fileType = fileTypeHint;
-
-            if (fileType == StaticFileServer::FileType::UNSPECIFIED)
-            {
-                fileType = guessFileType(fileContent);
-            }
-
-            if (fileType == StaticFileServer::FileType::TEXT)
-            {
-                mimeType = "text/plain";
-            }
-            else if(fileType == StaticFileServer::FileType::BINARY)
-            {
-                mimeType = "application/octet-stream";
-            }
-            else
-            {
-                return false;
-            }
+            merged.push_back(ranges[i]);
         }
     }
+
+    ranges = merged;
     return true;
 }
 
-bool StaticFileServer::getFileByAbsolutePath(const QString &absolutePath, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress) const
+/*!
+ * \brief isRangeApplicable evaluates If-Range (RFC 7233, 3.2), a Range is only honored if the client's copy is current
+ */
+static bool isRangeApplicable(HttpRequest &request, const QString &etag, const QDateTime &lastModified)
 {
-    QFileInfo fileInfo(absolutePath);
+    QWeakPointer<QString> ifRange = request.getHeader().getHeaderInfo("If-Range");
+
+    if (ifRange.isNull())
+    {
+        return true;
+    }
 
-    qDebug() << fileInfo.canonicalFilePath() << fileInfo.absoluteFilePath();
+    QString validator = ifRange.data()->trimmed();
 
-    if (!fileInfo.isFile())
+    if (validator.startsWith("W/"))
     {
+        // weak entity tags never match for ranges
         return false;
     }
 
-    if (!fileInfo.exists())
+    if (validator.startsWith('"'))
     {
-        return false;
+        return !etag.isEmpty() && validator == etag;
     }
 
-    if (useCache)
+    QDateTime date = HttpHeader::fromHttpDate(validator);
+
+    return date.isValid() && date.toSecsSinceEpoch() == lastModified.toSecsSinceEpoch();
+}
+
+/*!
+ * \brief isNotModified evaluates If-None-Match, or else If-Modified-Since (RFC 7232, 6)
+ * \return true if the client's copy is current and 304 can be answered
+ */
+static bool isNotModified(HttpRequest &request, const QString &etag, const QDateTime &lastModified)
+{
+    QWeakPointer<QString> ifNoneMatch = request.getHeader().getHeaderInfo("If-None-Match");
+
+    if (!ifNoneMatch.isNull())
     {
-        StaticFileServer::m_fileCacheMutex.lock();
-        if (!StaticFileServer::m_fileCache.contains(fileInfo.canonicalFilePath()))
-        {
-            m_fileCacheMutex.unlock();
+        return HttpHeader::matchesETag(*ifNoneMatch.data(), etag);
+    }
 
-            QFile file(fileInfo.canonicalFilePath());
-            if (file.open(QFile::ReadOnly))
-            {
-                fileContent = file.readAll();
-                file.close();
-            }
+    QWeakPointer<QString> ifModifiedSince = request.getHeader().getHeaderInfo("If-Modified-Since");
 
-            if(m_mimeTypeMap.contains(fileInfo.suffix()))
-            {
-                mimeType = m_mimeTypeMap[fileInfo.suffix()];
-            }
-            else
-            {
+    if (!ifModifiedSince.isNull())
+    {
+        QDateTime date = HttpHeader::fromHttpDate(*ifModifiedSince.data());
 
-                StaticFileServer::FileType fileType = fileTypeHint;
+        // HTTP dates have a resolution of one second
+        return date.isValid() && lastModified.toSecsSinceEpoch() <= date.toSecsSinceEpoch();
+    }
 
-                if (fileType == StaticFileServer::FileType::UNSPECIFIED)
-                {
-                    fileType = guessFileType(fileContent);
-                }
+    return false;
+}
 
-                if (fileType == StaticFileServer::FileType::TEXT)
-                {
-                    mimeType = "text/plain";
-                }
-                else if(fileType == StaticFileServer::FileType::BINARY)
-                {
-                    mimeType = "application/octet-stream";
-                }
-                else
-                {
-                    return false;
-                }
-            }
+static void setValidators(HttpResponse &response, const QString &etag, const QDateTime &lastModified)
+{
+    if (!etag.isEmpty())
+    {
+        response.setHeader("ETag", QSharedPointer<QString>(new QString(etag)));
+    }
 
-            FileCacheItem *item = new FileCacheItem(fileInfo, fileContent, StaticFileServer::FileType::UNSPECIFIED, mimeType);
-            qint64 sizeInKB = item->sizeInKB();
+    response.setHeader("Last-Modified", QSharedPointer<QString>(new QString(HttpHeader::toHttpDate(lastModified))));
+}
 
-            if (sizeInKB < 1)
-            {
-                sizeInKB = 1;
-            }
+/*!
+ * \brief serveRanges answers a Range request with 206, single or multipart/byteranges, or 416
+ * \param[in] data the representation, cached content or a file mapping
+ * \param[in] mapping the mapping data points into, if any, a single range is then sent from it without a copy
+ * \return false if the Range header should be ignored and the whole representation sent, also for a multipart answer
+ * larger than maximumMultipartSize
+ */
+static bool serveRanges(HttpResponse &response, const QString &rangeHeader, const QString &mimeType,
+                        const char *data, qint64 size, const QSharedPointer<MappedFile> &mapping)
+{
+    QVector<QPair<qint64, qint64>> ranges;
 
-            StaticFileServer::m_fileCacheMutex.lock();
+    if (!parseByteRanges(rangeHeader, size, ranges))
+    {
+        return false;
+    }
 
-            StaticFileServer::m_fileCache.insert(fileInfo.absoluteFilePath(), item, (int) sizeInKB);
-            qDebug() << "file" << fileInfo.absoluteFilePath() << "is in cache" << sizeInKB;
+    if (ranges.isEmpty())
+    {
+        response.setStatusCode(416);
+        response.setHeader("Content-Range", QSharedPointer<QString>(new QString("bytes */" % QString::number(size))));
+        response.finish();
+        return true;
+    }
 
-            StaticFileServer::m_fileCacheMutex.unlock();
+    qint64 multipartSize = 0;
 
-            if (compress)
-            {
-                fileContent = item->m_fileGZipContent;
-            }
+    for(int i = 0; i < ranges.size(); ++i)
+    {
+        multipartSize += ranges[i].second - ranges[i].first + 1;
+    }
 
-            md5 = item->m_md5;
+    if (ranges.size() > 1 && multipartSize > maximumMultipartSize)
+    {
+        return false;
+    }
+
+    response.setStatusCode(206);
+
+    if (ranges.size() == 1)
+    {
+        response.setHeader("Content-Range", QSharedPointer<QString>(new QString("bytes " % QString::number(ranges[0].first) % "-"
+                                                                               % QString::number(ranges[0].second) % "/" % QString::number(size))));
+        qint64 length = ranges[0].second - ranges[0].first + 1;
+
+        if (mapping.isNull())
+        {
+            response << QByteArray(data + ranges[0].first, static_cast<int>(length));
         }
         else
         {
-            FileCacheItem *item = StaticFileServer::m_fileCache[fileInfo.absoluteFilePath()];
-
-            if (compress)
-            {
-                fileContent = item->m_fileGZipContent;
-            }
-            else
-            {
-                fileContent = item->m_fileContent;
-            }
-            mimeType = item->m_mimeType;
-            md5 = item->m_md5;
-            qDebug() << "file" << item->m_fileInfo.absoluteFilePath() << "is from cache";
-            StaticFileServer::m_fileCacheMutex.unlock();
+            mapping->adviseWillNeed(ranges[0].first, length);
+            response.setMappedBody(mapping, ranges[0].first, length);
         }
+
+        response.finish(mimeType);
+        return true;
     }
-    else
+
+    QByteArray boundary = QUuid::createUuid().toRfc4122().toHex();
+
+    for(int i = 0; i < ranges.size(); ++i)
+    {
+        QString partHeader = "\r\n--" % QString::fromLatin1(boundary) % "\r\n"
+                             "Content-Type: " % mimeType % "\r\n"
+                             "Content-Range: bytes " % QString::number(ranges[i].first) % "-" % QString::number(ranges[i].second)
+                             % "/" % QString::number(size) % "\r\n\r\n";
+        response << partHeader.toLatin1();
+        response << QByteArray::fromRawData(data + ranges[i].first, static_cast<int>(ranges[i].second - ranges[i].first + 1));
+    }
+
+    response << QByteArray("\r\n--" + boundary + "--\r\n");
+    response.finish("multipart/byteranges; boundary=" % QString::fromLatin1(boundary));
+    return true;
+}
+
+// shared by every response, so that marking one immutable costs no allocation
+static const QSharedPointer<QString> &immutableCacheControl()
+{
+    static const QSharedPointer<QString> value(new QString("public, max-age=31536000, immutable"));
+    return value;
+}
+
+bool StaticFileServer::serve(HttpRequest &request, HttpResponse &response) const
+{
+    QString path = request.getHeader().getPath();
+    QString fingerprint;
+
+    if (!m_assetManifest.isNull())
     {
-        QFile file(fileInfo.canonicalFilePath());
-        if (file.open(QFile::ReadOnly))
+        QString logicalPath;
+
+        switch (m_assetManifest->resolve(path, logicalPath, fingerprint))
         {
-            fileContent = file.readAll();
-            file.close();
+        case AssetManifest::Match::Current:
+            path = logicalPath;
+            break;
+        case AssetManifest::Match::Superseded:
+            // a page rendered before the file changed, it gets the new content, but only for as long as usual
+            path = logicalPath;
+            fingerprint.clear();
+            break;
+        default:
+            break;
         }
+    }
+
+    if (!m_bundle.isNull())
+    {
+        return serveBundled(request, response, path, !fingerprint.isEmpty());
+    }
+
+    StaticFileMetadataCache::Metadata metadata;
+
+    if (!resolve(m_rootAbsolutePath % path, true, metadata))
+    {
+        return false;
+    }
+
+    if (!StaticFileCache::getSingleton().admits(metadata.m_size))
+    {
+        // not hashed per request, the digest fingerprintFile() filed under the file's current identity stands in for
+        // it, without one the URL can't be checked and isn't promised to be immutable
+        QString digest;
 
-        if(m_mimeTypeMap.contains(fileInfo.suffix()))
+        if (!fingerprint.isEmpty()
+                && (m_etagMode != ETagMode::ContentHash
+                    || (StaticFileArtifactCache::getSingleton().loadDigest(fileIdentity(metadata.m_canonicalPath), digest)
+                        && AssetManifest::matches(digest, fingerprint))))
         {
-            mimeType = m_mimeTypeMap[fileInfo.suffix()];
+            response.setHeader("Cache-Control", immutableCacheControl());
         }
-        else
-        {
-            StaticFileServer::FileType fileType = fileTypeHint;
 
-            if (fileType == StaticFileServer::FileType::UNSPECIFIED)
-            {
-                fileType = guessFileType(fileContent);
-            }
+        response.setHeader("Accept-Ranges", QSharedPointer<QString>(new QString("bytes")));
+        return serveUncached(request, response, metadata);
+    }
 
-            if (fileType == StaticFileServer::FileType::TEXT)
-            {
-                mimeType = "text/plain";
-            }
-            else if(fileType == StaticFileServer::FileType::BINARY)
-            {
-                mimeType = "application/octet-stream";
+    const QString &canonicalFilePath = metadata.m_canonicalPath;
+    StaticFileCache::Item created;
+    const StaticFileCache::Item &item = findItem(canonicalFilePath, FileType::UNSPECIFIED, created);
+
+    if (item.isNull())
+    {
+        return false;
+    }
+
+    // the manifest lags a write by a moment, a content hash tells whether the URL still names these very bytes
+    if (!fingerprint.isEmpty() && (m_etagMode != ETagMode::ContentHash || AssetManifest::matches(item->m_etag, fingerprint)))
+    {
+        response.setHeader("Cache-Control", immutableCacheControl());
+    }
+
+    QWeakPointer<QString> acceptEncoding = request.getHeader().getHeaderInfo("Accept-Encoding");
+    QVector<ContentEncoding> acceptedEncodings = acceptedContentEncodings(acceptEncoding.isNull() ? QString() : *acceptEncoding.data());
+    ContentEncoding encoding = selectEncoding(item, canonicalFilePath, acceptedEncodings);
+    QDateTime lastModified = item->m_lastModified;
+    QString etag = item->etag(encoding);
+
+    // the encoding has been negotiated here, finish() must not gzip the identity variant again
+    response.setGZipAccepted(false);
+
+    if (isNotModified(request, etag, lastModified))
+    {
+        response.setHeader("Accept-Ranges", QSharedPointer<QString>(new QString("bytes")));
+
+        if (item->m_varies)
+        {
+            response.setHeader("Vary", QSharedPointer<QString>(new QString("Accept-Encoding")));
+        }
+
+        setValidators(response, etag, lastModified);
+        response.setStatusCode(304);
+        response.finish();
+        return true;
+    }
+
+    QWeakPointer<QString> range = request.getHeader().getHeaderInfo("Range");
+
+    // ranges are always taken from the identity representation, the offsets a resumed download relies on
+    // then don't depend on the encoding negotiated by each request
+    if (!range.isNull() && isRangeApplicable(request, item->m_etag, lastModified))
+    {
+        const QByteArray &content = item->m_fileContent;
+
+        response.setHeader("Accept-Ranges", QSharedPointer<QString>(new QString("bytes")));
+        setValidators(response, item->m_etag, lastModified);
+
+        if (serveRanges(response, *range.data(), item->m_mimeType, content.constData(), content.size(), QSharedPointer<MappedFile>()))
+        {
+            return true;
+        }
+
+        // the prepared header carries these already
+        response.removeHeader("Accept-Ranges");
+        response.removeHeader("ETag");
+        response.removeHeader("Last-Modified");
+    }
+
+    // a plain hit, the header of the variant was serialized when the variant was cached
+    response.finishWithPreparedHeader(item->preparedHeader(encoding), item->variant(encoding));
+    StaticFileCache::getSingleton().recordTransfer(item->m_fileContent.size(), item->variant(encoding).size());
+
+    return true;
+}
+
+bool StaticFileServer::useBundle(const QString &fileName)
+{
+    QSharedPointer<const StaticBundle> bundle(new StaticBundle(fileName));
+
+    if (!bundle->isValid())
+    {
+        return false;
+    }
+
+    qDebug() << "serving" << bundle->entryCount() << "files from bundle" << fileName;
+    m_bundle = bundle;
+    return true;
+}
+
+bool StaticFileServer::serveBundled(HttpRequest &request, HttpResponse &response, const QString &path, bool immutable) const
+{
+    // paths are looked up as they are, a path that isn't in the index can't lead anywhere else
+    const StaticBundle::Entry *entry = m_bundle->find(path);
+
+    if (!entry)
+    {
+        return false;
+    }
+
+    if (immutable)
+    {
+        response.setHeader("Cache-Control", immutableCacheControl());
+    }
+
+    QWeakPointer<QString> acceptEncoding = request.getHeader().getHeaderInfo("Accept-Encoding");
+    QVector<ContentEncoding> acceptedEncodings = acceptedContentEncodings(acceptEncoding.isNull() ? QString() : *acceptEncoding.data());
+    ContentEncoding encoding = ContentEncoding::Identity;
+
+    for(int i = 0; i < acceptedEncodings.size(); ++i)
+    {
+        if (entry->hasEncoding(acceptedEncodings[i]))
+        {
+            encoding = acceptedEncodings[i];
+            break;
+        }
+    }
+
+    const HttpHeader &requestHeader = request.getHeader();
+    bool conditional = requestHeader.getHeaderInfo().contains("If-None-Match") || requestHeader.getHeaderInfo().contains("If-Modified-Since");
+    QWeakPointer<QString> range = requestHeader.getHeaderInfo("Range");
+
+    // the common case, nothing but the lookup and the two writes
+    if (!conditional && range.isNull())
+    {
+        response.finishWithPreparedHeader(m_bundle->bytes(entry->m_preparedHeader[static_cast<int>(encoding)]),
+                                          m_bundle->bytes(entry->m_content[static_cast<int>(encoding)]));
+        return true;
+    }
+
+    QString identityETag = m_bundle->latin1(entry->m_etag);
+    QString etag = variantETag(identityETag, encoding);
+    QDateTime lastModified = QDateTime::fromMSecsSinceEpoch(entry->m_lastModifiedInMilliseconds);
+    bool varies = entry->m_encodings != (1u << static_cast<int>(ContentEncoding::Identity));
+
+    response.setGZipAccepted(false);
+
+    if (isNotModified(request, etag, lastModified))
+    {
+        response.setHeader("Accept-Ranges", QSharedPointer<QString>(new QString("bytes")));
+
+        if (varies)
+        {
+            response.setHeader("Vary", QSharedPointer<QString>(new QString("Accept-Encoding")));
+        }
+
+        setValidators(response, etag, lastModified);
+        response.setStatusCode(304);
+        response.finish();
+        return true;
+    }
+
+    if (!range.isNull() && isRangeApplicable(request, identityETag, lastModified))
+    {
+        const StaticBundle::Range &content = entry->m_content[static_cast<int>(ContentEncoding::Identity)];
+
+        response.setHeader("Accept-Ranges", QSharedPointer<QString>(new QString("bytes")));
+        setValidators(response, identityETag, lastModified);
+
+        if (serveRanges(response, *range.data(), m_bundle->latin1(entry->m_mimeType), m_bundle->data(content),
+                        static_cast<qint64>(content.m_length), QSharedPointer<MappedFile>()))
+        {
+            return true;
+        }
+
+        response.removeHeader("Accept-Ranges");
+        response.removeHeader("ETag");
+        response.removeHeader("Last-Modified");
+    }
+
+    response.finishWithPreparedHeader(m_bundle->bytes(entry->m_preparedHeader[static_cast<int>(encoding)]),
+                                      m_bundle->bytes(entry->m_content[static_cast<int>(encoding)]));
+    return true;
+}
+
+bool StaticFileServer::serveUncached(HttpRequest &request, HttpResponse &response, const StaticFileMetadataCache::Metadata &resolved) const
+{
+    // too large to be copied into the heap for every request, the file is sent from a mapping shared by all of them,
+    // never read into a buffer
+    StaticFileMetadataCache::Metadata metadata = resolved;
+    QSharedPointer<MappedFile> mapping = MappedFileRegistry::getSingleton().acquire(metadata.m_canonicalPath, metadata.m_size, metadata.m_lastModified);
+
+    if (mapping.isNull())
+    {
+        // changed since it was resolved, e.g. still being written, it is looked at once more
+        QFileInfo fileInfo(metadata.m_canonicalPath);
+
+        if (!fileInfo.isFile())
+        {
+            return false;
+        }
+
+        metadata.m_size = fileInfo.size();
+        metadata.m_lastModified = fileInfo.lastModified();
+
+        if (metadata.m_size > 0)
+        {
+            mapping = MappedFileRegistry::getSingleton().acquire(metadata.m_canonicalPath, metadata.m_size, metadata.m_lastModified);
+        }
+
+        if (mapping.isNull() && metadata.m_size > 0)
+        {
+            response.setStatusCode(503);
+            response.setHeader("Retry-After", QSharedPointer<QString>(new QString("1")));
+            response.finish();
+            return true;
+        }
+    }
+
+    // too large to be cached, and to be sniffed for text, its type comes from its extension
+    QString mimeType = mimeTypeForSuffix(QFileInfo(metadata.m_canonicalPath).suffix());
+
+    if (mimeType.isNull())
+    {
+        mimeType = "application/octet-stream";
+    }
+
+    // hashing a large file on every request would cost more than sending it
+    QString etag = m_etagMode == ETagMode::FileIdentity ? fileIdentityETag(metadata.m_canonicalPath) : QString();
+    QDateTime lastModified = metadata.m_lastModified;
+
+    setValidators(response, etag, lastModified);
+    response.setGZipAccepted(false);
+
+    if (isNotModified(request, etag, lastModified))
+    {
+        response.setStatusCode(304);
+        response.finish();
+        return true;
+    }
+
+    QWeakPointer<QString> range = request.getHeader().getHeaderInfo("Range");
+
+    // only the requested pages are read, seeking in a video doesn't load the whole file
+    if (!range.isNull() && isRangeApplicable(request, etag, lastModified)
+            && serveRanges(response, *range.data(), mimeType,
+                           mapping.isNull() ? nullptr : mapping->data(),
+                           mapping.isNull() ? 0 : mapping->size(), mapping))
+    {
+        return true;
+    }
+
+    // an empty file has no mapping, and no body
+    if (!mapping.isNull())
+    {
+        response.setMappedBody(mapping, 0, mapping->size());
+    }
+
+    response.finish(mimeType);
+
+    return true;
+}
+
+bool StaticFileServer::isInsideRoot(const QString &canonicalPath) const
+{
+    // "/srv/www2" must not pass for a root of "/srv/www"
+    return canonicalPath.startsWith(m_rootCanonicalPath)
+            && (canonicalPath.size() == m_rootCanonicalPath.size()
+                || m_rootCanonicalPath.endsWith('/')
+                || canonicalPath.at(m_rootCanonicalPath.size()) == '/');
+}
+
+bool StaticFileServer::resolve(const QString &absolutePath, bool insideRoot, StaticFileMetadataCache::Metadata &metadata) const
+{
+    StaticFileMetadataCache &metadataCache = StaticFileMetadataCache::getSingleton();
+
+    switch (metadataCache.find(absolutePath, metadata))
+    {
+    case StaticFileMetadataCache::State::Found:
+        // entries are shared by all servers of the thread, the root is checked again for this one
+        return !insideRoot || isInsideRoot(metadata.m_canonicalPath);
+    case StaticFileMetadataCache::State::Missing:
+        return false;
+    default:
+        break;
+    }
+
+    QFileInfo fileInfo(absolutePath);
+    QString canonicalPath = fileInfo.canonicalFilePath();
+
+    if (canonicalPath.isEmpty() || !fileInfo.isFile())
+    {
+        metadataCache.insertMissing(absolutePath);
+        return false;
+    }
+
+    metadata.m_canonicalPath = canonicalPath;
+    metadata.m_size = fileInfo.size();
+    metadata.m_lastModified = fileInfo.lastModified();
+    // StaticFileWatcher sees files replaced in a watched root, but only sees cached files written in place. A file
+    // too large for the cache, or outside a watched root, can only be trusted for a moment.
+    bool watched = m_watched && isInsideRoot(canonicalPath) && StaticFileCache::getSingleton().admits(metadata.m_size);
+    metadata.m_expiresAt = watched ? 0 : QDateTime::currentMSecsSinceEpoch() + StaticFileMetadataCache::m_ttlInMilliseconds;
+
+    metadataCache.insert(absolutePath, metadata);
+
+    return !insideRoot || isInsideRoot(canonicalPath);
+}
+
+bool StaticFileServer::getFileByPath(const QString &path, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress, bool *compressed) const
+{
+    return getFile(m_rootAbsolutePath % path, true, fileContent, mimeType, md5, fileTypeHint, useCache, compress, compressed);
+}
+
+bool StaticFileServer::getFileByAbsolutePath(const QString &absolutePath, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress, bool *compressed) const
+{
+    return getFile(absolutePath, false, fileContent, mimeType, md5, fileTypeHint, useCache, compress, compressed);
+}
+
+bool StaticFileServer::getFile(const QString &absolutePath, bool insideRoot, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress, bool *compressed) const
+{
+    if (compressed)
+    {
+        *compressed = false;
+    }
+
+    StaticFileMetadataCache::Metadata metadata;
+
+    if (!resolve(absolutePath, insideRoot, metadata))
+    {
+        return false;
+    }
+
+    if (!useCache)
+    {
+        return readFile(QFileInfo(metadata.m_canonicalPath), fileContent, mimeType, fileTypeHint);
+    }
+
+    StaticFileCache::Item created;
+    const StaticFileCache::Item &item = findItem(metadata.m_canonicalPath, fileTypeHint, created);
+
+    if (item.isNull())
+    {
+        return false;
+    }
+
+    QVector<ContentEncoding> acceptedEncodings;
+
+    if (compress)
+    {
+        acceptedEncodings.push_back(ContentEncoding::GZip);
+    }
+    acceptedEncodings.push_back(ContentEncoding::Identity);
+
+    ContentEncoding encoding = selectEncoding(item, metadata.m_canonicalPath, acceptedEncodings);
+
+    fileContent = item->variant(encoding);
+    mimeType = item->m_mimeType;
+    md5 = item->m_etag;
+
+    if (compressed)
+    {
+        *compressed = encoding == ContentEncoding::GZip;
+    }
+
+    return true;
+}
+
+const StaticFileCache::Item &StaticFileServer::findItem(const QString &canonicalFilePath, FileType fileTypeHint, StaticFileCache::Item &created) const
+{
+    // an L1 hit hands out the thread's own reference, without touching the item's shared reference count
+    const StaticFileCache::Item &cached = StaticFileCache::getSingleton().find(canonicalFilePath);
+
+    if (!cached.isNull())
+    {
+        return cached;
+    }
+
+    created = createItem(QFileInfo(canonicalFilePath), fileTypeHint);
+
+    if (!created.isNull())
+    {
+        insertItem(canonicalFilePath, created);
+    }
+
+    return created;
+}
+
+StaticFileCache::Item StaticFileServer::createItem(const QFileInfo &fileInfo, FileType fileTypeHint) const
+{
+    QByteArray fileContent;
+    QString mimeType;
+    QString identity = fileIdentity(fileInfo.canonicalFilePath());
+
+    if (!readFile(fileInfo, fileContent, mimeType, fileTypeHint))
+    {
+        return StaticFileCache::Item();
+    }
+
+    // artifacts of a file written while it was read would be filed under the wrong content
+    if (!identity.isEmpty() && fileIdentity(fileInfo.canonicalFilePath()) != identity)
+    {
+        identity.clear();
+    }
+
+    QString etag;
+
+    if (m_etagMode == ETagMode::FileIdentity)
+    {
+        etag = identity.isEmpty() ? fileIdentityETag(fileInfo.absoluteFilePath()) : QString("W/\"" % identity % "\"");
+    }
+    else if (!StaticFileArtifactCache::getSingleton().loadDigest(identity, etag))
+    {
+        etag = contentETag(fileContent);
+        StaticFileArtifactCache::getSingleton().storeDigest(identity, etag);
+    }
+
+    StaticFileCache::Item item(new FileCacheItem(fileInfo, fileContent, StaticFileServer::FileType::UNSPECIFIED, mimeType, etag));
+    item->m_artifactKey = identity;
+    item->loadSidecars();
+
+    return item;
+}
+
+void StaticFileServer::insertItem(const QString &canonicalFilePath, const StaticFileCache::Item &item) const
+{
+    StaticFileCache::getSingleton().insert(canonicalFilePath, item);
+
+    if (m_watched)
+    {
+        StaticFileWatcher::getSingleton().watchFile(canonicalFilePath);
+    }
+}
+
+bool StaticFileServer::cacheFile(const QFileInfo &fileInfo) const
+{
+    if (!fileInfo.isFile() || !StaticFileCache::getSingleton().admits(fileInfo.size()))
+    {
+        return false;
+    }
+
+    StaticFileCache::Item item = createItem(fileInfo, FileType::UNSPECIFIED);
+
+    if (item.isNull())
+    {
+        return false;
+    }
+
+    // already on a pool thread, every variant is produced before the item is published
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        ContentEncoding encoding = static_cast<ContentEncoding>(i);
+
+        if (item->claimVariant(encoding))
+        {
+            produceVariant(item, encoding);
+        }
+    }
+
+    insertItem(fileInfo.canonicalFilePath(), item);
+
+    return true;
+}
+
+void StaticFileServer::watch(bool prewarm)
+{
+    m_watched = true;
+    StaticFileWatcher::getSingleton().watchRoot(*this, m_rootCanonicalPath, prewarm);
+}
+
+void StaticFileServer::prewarm() const
+{
+    QThreadPool::globalInstance()->start(new PrewarmTask(*this, QStringList()));
+}
+
+void StaticFileServer::refresh(const QStringList &canonicalPaths) const
+{
+    QThreadPool::globalInstance()->start(new PrewarmTask(*this, canonicalPaths));
+}
+
+void StaticFileServer::prewarmFiles(const QStringList &canonicalPaths) const
+{
+    if (!canonicalPaths.isEmpty())
+    {
+        for(int i = 0; i < canonicalPaths.size(); ++i)
+        {
+            cacheFile(QFileInfo(canonicalPaths[i]));
+        }
+
+        return;
+    }
+
+    // half of the cache at most, the rest is left to what is actually requested
+    qint64 budgetInKB = StaticFileCache::getSingleton().capacityInKB() / 2;
+    qint64 usedInKB = 0;
+
+    QDirIterator iter(m_rootCanonicalPath, QDir::Files, QDirIterator::Subdirectories);
+
+    while (iter.hasNext() && usedInKB < budgetInKB)
+    {
+        QFileInfo fileInfo(iter.next());
+
+        if (StaticFileCache::getSingleton().contains(fileInfo.canonicalFilePath()))
+        {
+            continue;
+        }
+
+        if (cacheFile(fileInfo))
+        {
+            usedInKB += fileInfo.size() / 1024;
+        }
+    }
+}
+
+void StaticFileServer::fingerprintAssets()
+{
+    if (!m_bundle.isNull())
+    {
+        // the bundle can't change under the server, its manifest is complete from the start and belongs to it alone
+        m_assetManifest.reset(new AssetManifest());
+
+        for(int i = 0; i < m_bundle->entryCount(); ++i)
+        {
+            const StaticBundle::Entry &entry = m_bundle->entry(i);
+            m_assetManifest->insert(m_bundle->utf16(entry.m_path), m_bundle->latin1(entry.m_etag));
+        }
+
+        return;
+    }
+
+    bool created = false;
+    m_assetManifest = AssetManifest::forRoot(m_rootCanonicalPath, &created);
+
+    if (created)
+    {
+        QThreadPool::globalInstance()->start(new AssetFingerprintTask(*this, QStringList()));
+    }
+}
+
+QString StaticFileServer::assetUrl(const QString &logicalPath) const
+{
+    return m_assetManifest.isNull() ? logicalPath : m_assetManifest->url(logicalPath);
+}
+
+void StaticFileServer::refreshAssets(const QStringList &canonicalPaths) const
+{
+    if (!AssetManifest::findRoot(m_rootCanonicalPath).isNull())
+    {
+        QThreadPool::globalInstance()->start(new AssetFingerprintTask(*this, canonicalPaths));
+    }
+}
+
+void StaticFileServer::fingerprintFiles(const QStringList &canonicalPaths) const
+{
+    // the watcher's copy of the server may predate fingerprintAssets(), the manifest is looked up by root
+    QSharedPointer<AssetManifest> manifest = AssetManifest::findRoot(m_rootCanonicalPath);
+
+    if (manifest.isNull())
+    {
+        return;
+    }
+
+    QStringList directories = canonicalPaths;
+
+    if (directories.isEmpty())
+    {
+        directories.push_back(m_rootCanonicalPath);
+    }
+
+    int rootLength = m_rootCanonicalPath.endsWith('/') ? m_rootCanonicalPath.size() - 1 : m_rootCanonicalPath.size();
+
+    for(int i = 0; i < directories.size(); ++i)
+    {
+        QFileInfo fileInfo(directories[i]);
+
+        if (fileInfo.isFile())
+        {
+            fingerprintFile(fileInfo, *manifest);
+            continue;
+        }
+
+        QString logicalPath = directories[i].mid(rootLength);
+
+        if (!fileInfo.isDir())
+        {
+            // deleted, along with whatever it contained
+            manifest->remove(logicalPath);
+        }
+
+        // files deleted or renamed away
+        QStringList published = manifest->logicalPathsUnder(logicalPath % "/");
+
+        for(int j = 0; j < published.size(); ++j)
+        {
+            if (!QFileInfo(m_rootCanonicalPath.left(rootLength) % published[j]).isFile())
+            {
+                manifest->remove(published[j]);
             }
-            else
+        }
+
+        if (!fileInfo.isDir())
+        {
+            continue;
+        }
+
+        QDirIterator iter(directories[i], QDir::Files, QDirIterator::Subdirectories);
+
+        while (iter.hasNext())
+        {
+            fingerprintFile(QFileInfo(iter.next()), *manifest);
+        }
+    }
+}
+
+void StaticFileServer::fingerprintFile(const QFileInfo &fileInfo, AssetManifest &manifest) const
+{
+    QString canonicalPath = fileInfo.canonicalFilePath();
+
+    if (canonicalPath.isEmpty() || !isInsideRoot(canonicalPath))
+    {
+        return;
+    }
+
+    QString logicalPath = canonicalPath.mid(m_rootCanonicalPath.endsWith('/') ? m_rootCanonicalPath.size() - 1 : m_rootCanonicalPath.size());
+    QString identity = fileIdentity(canonicalPath);
+    QString etag;
+
+    // the digest is the one the cache files under the same identity, a restart hashes nothing that didn't change
+    if (!StaticFileArtifactCache::getSingleton().loadDigest(identity, etag))
+    {
+        QFile file(canonicalPath);
+
+        if (!file.open(QFile::ReadOnly))
+        {
+            return;
+        }
+
+        etag = contentETag(file.readAll());
+
+        if (!identity.isEmpty() && fileIdentity(canonicalPath) == identity)
+        {
+            StaticFileArtifactCache::getSingleton().storeDigest(identity, etag);
+        }
+    }
+
+    manifest.insert(logicalPath, etag);
+}
+
+ContentEncoding StaticFileServer::selectEncoding(const StaticFileCache::Item &item, const QString &canonicalFilePath, const QVector<ContentEncoding> &acceptedEncodings) const
+{
+    bool compressionPending = false;
+
+    for(int i = 0; i < acceptedEncodings.size(); ++i)
+    {
+        ContentEncoding encoding = acceptedEncodings[i];
+
+        if (item->isVariantReady(encoding))
+        {
+            return encoding;
+        }
+
+        // only the most preferred missing variant is produced, the others may never be asked for
+        if (!compressionPending && item->m_variants[static_cast<int>(encoding)].m_state.loadAcquire() != FileCacheItem::VariantUseless)
+        {
+            compressionPending = true;
+
+            if (item->claimVariant(encoding))
             {
-                return false;
+                QThreadPool::globalInstance()->start(new CompressionTask(canonicalFilePath, item, encoding));
             }
         }
     }
+
+    // the client refused identity, but it is all there is for now
+    return ContentEncoding::Identity;
+}
+
+bool StaticFileServer::readFile(const QFileInfo &fileInfo, QByteArray &fileContent, QString &mimeType, FileType fileTypeHint) const
+{
+    QFile file(fileInfo.canonicalFilePath());
+    if (file.open(QFile::ReadOnly))
+    {
+        fileContent = file.readAll();
+        file.close();
+    }
+    else
+    {
+        // deleted or made unreadable since it was resolved
+        return false;
+    }
+
+    if(m_mimeTypeMap.contains(fileInfo.suffix()))
+    {
+        mimeType = m_mimeTypeMap[fileInfo.suffix()];
+    }
+    else
+    {
+        StaticFileServer::FileType fileType = fileTypeHint;
+
+        if (fileType == StaticFileServer::FileType::UNSPECIFIED)
+        {
+            fileType = guessFileType(fileContent);
+        }
+
+        if (fileType == StaticFileServer::FileType::TEXT)
+        {
+            mimeType = "text/plain";
+        }
+        else if(fileType == StaticFileServer::FileType::BINARY)
+        {
+            mimeType = "application/octet-stream";
+        }
+        else
+        {
+            return false;
+        }
+    }
+
     return true;
 }
 
+QString StaticFileServer::fileIdentity(const QString &filePath)
+{
+    struct stat status;
+
+    if (::stat(QFile::encodeName(filePath).constData(), &status) != 0)
+    {
+        return QString();
+    }
+
+#ifdef __APPLE__
+    qint64 modifiedNanoseconds = static_cast<qint64>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+    qint64 modifiedNanoseconds = static_cast<qint64>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+
+    return QString::number(static_cast<quint64>(status.st_ino), 16) % "-"
+            % QString::number(modifiedNanoseconds, 16) % "-"
+            % QString::number(static_cast<qint64>(status.st_size), 16);
+}
+
+QString StaticFileServer::fileIdentityETag(const QString &filePath)
+{
+    QString identity = fileIdentity(filePath);
+
+    return identity.isEmpty() ? QString() : QString("W/\"" % identity % "\"");
+}
+
 StaticFileServer::FileType StaticFileServer::guessFileType(const QByteArray &fileContent) const
 {
     //Based on:
@@ -6,14 +6,26 @@
 #include <QFileInfo>
 #include <QString>
 #include <QHash>
-#include <QCache>
-#include <QMutex>
+#include <QAtomicInteger>
+#include <QStringList>
+#include <QSharedPointer>
+#include "Compression.h"
+#include "StaticFileMetadataCache.h"
+
+class StaticBundle;
+class AssetManifest;
+
+class HttpRequest;
+class HttpResponse;
 
 class StaticFileServer : public QObject
 {
     Q_OBJECT
 private:
     QDir m_rootDir;
+    // resolved once, QDir caches its paths lazily and isn't safe to query from several workers at once
+    QString m_rootAbsolutePath;
+    QString m_rootCanonicalPath;
 
 public:
     enum class FileType
@@ -23,32 +35,247 @@ public:
         UNSPECIFIED
     };
 
+    /*!
+     * \brief ETagMode selects how entity tags of served files are made
+     */
+    enum class ETagMode
+    {
+        //! strong, a hash of the content, see contentETag(), computed once when a file is cached. Uncached files get no ETag
+        ContentHash,
+        //! weak, from the inode, modification time and size of the file, no file is hashed
+        FileIdentity
+    };
+
+private:
+    ETagMode m_etagMode;
+    // cached files are registered with StaticFileWatcher
+    bool m_watched;
+    // set in bundle mode, files are then served from the bundle only, never from the root directory
+    QSharedPointer<const StaticBundle> m_bundle;
+    // set once fingerprintAssets() is called, shared by the servers of the root, see AssetManifest::forRoot()
+    QSharedPointer<AssetManifest> m_assetManifest;
+
+public:
+    /*! \brief FileCacheItem is a cached file with its compressed variants
+     *
+     * A variant per content encoding is either loaded from a precompressed sidecar file next to the original
+     * (app.js.br, app.js.zst, app.js.gz), or produced once at the highest level by a background thread, on the first
+     * request preferring it, and only for compressible types. Until a variant's state is VariantReady, its content
+     * must not be read.
+     */
     class FileCacheItem
     {
     public:
+        enum VariantState
+        {
+            VariantPending,
+            VariantCompressing,
+            VariantReady,
+            // not compressible, too small, not supported, or compression didn't save anything
+            VariantUseless
+        };
+
+        class Variant
+        {
+        public:
+            QByteArray m_content;
+            // status line and header fields of a full response with this content, see HttpResponse::prepareHeader()
+            QByteArray m_preparedHeader;
+            QAtomicInt m_state;
+
+            Variant()
+                :m_content(),
+                  m_preparedHeader(),
+                  m_state(VariantUseless)
+            {}
+        };
+
         QFileInfo m_fileInfo;
+        // read once by the creating thread, QFileInfo fills its stat cache lazily and can't be shared
+        QDateTime m_lastModified;
         QByteArray m_fileContent;
-        QByteArray m_fileGZipContent;
+        Variant m_variants[ContentEncodingCount];
         FileType m_fileType;
         QString m_mimeType;
-        QString m_md5;
+        // the strong hash of the content, or a weak tag of the file identity, see ETagMode
+        QString m_etag;
+        // whether responses carry Vary: Accept-Encoding, decided once the sidecars are loaded
+        bool m_varies;
+        // the file identity the content was read under, see StaticFileArtifactCache, empty if it changed meanwhile
+        QString m_artifactKey;
+
+        // bookkeeping of StaticFileCache
+        qint64 m_costInKB;
+        QAtomicInteger<qint64> m_lastAccess;
+        // still in the admission window, not yet in the main part of its shard
+        bool m_inWindow;
+        // the key it is cached under, and its place in the LRU list of its segment
+        QString m_cacheKey;
+        FileCacheItem *m_previous;
+        FileCacheItem *m_next;
+        // m_lastAccess when it was last moved to the front of its list, see StaticFileCache::Segment::coldest()
+        qint64 m_queuedAt;
 
     public:
 
-        FileCacheItem(const QFileInfo &fileInfo, const QByteArray &fileContent, const FileType fileType, const QString &mimeType);
+        FileCacheItem(const QFileInfo &fileInfo, const QByteArray &fileContent, const FileType fileType, const QString &mimeType, const QString &etag);
+
+        unsigned int sizeInKB() const;
+
+        /*!
+         * \brief loadSidecars reads the precompressed variants found next to the file
+         *
+         * A sidecar older than the file is ignored, it was not regenerated after the last change.
+         */
+        void loadSidecars();
+
+        /*!
+         * \brief claimVariant tells if the caller should produce a variant, only the first caller gets true
+         */
+        bool claimVariant(ContentEncoding encoding);
+
+        //! \brief setVariant publishes a variant, or marks it useless if it isn't smaller than the original
+        void setVariant(ContentEncoding encoding, const QByteArray &content);
+
+        bool isVariantReady(ContentEncoding encoding) const
+        {
+            return m_variants[static_cast<int>(encoding)].m_state.loadAcquire() == VariantReady;
+        }
+
+        //! \brief hasVariants tells if the file is, or may be, served in more than one encoding
+        bool hasVariants() const;
+
+        const QByteArray &variant(ContentEncoding encoding) const
+        {
+            return m_variants[static_cast<int>(encoding)].m_content;
+        }
 
-        unsigned int sizeInKB();
+        const QByteArray &preparedHeader(ContentEncoding encoding) const
+        {
+            return m_variants[static_cast<int>(encoding)].m_preparedHeader;
+        }
+
+        //! \brief etag returns the entity tag of a variant, each encoding is a different representation
+        QString etag(ContentEncoding encoding) const;
+
+    private:
+        //! \brief prepareHeader serializes the header of a variant, before the variant is published
+        void prepareHeader(ContentEncoding encoding);
     };
 
     StaticFileServer(const QDir &root = QDir("."));
     StaticFileServer(const StaticFileServer &in);
-    bool getFileByPath(const QString &path, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint = FileType::UNSPECIFIED, bool useCache = true, bool compress = false) const;
-    bool getFileByAbsolutePath(const QString &absolutePath, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint = FileType::UNSPECIFIED, bool useCache = true, bool compress = false) const;
+
+    /*!
+     * \brief serve answers a GET for a file under the root directory, in the best encoding the client accepts
+     *
+     * Sets Content-Encoding, Vary, Last-Modified and a per encoding ETag, then finishes the response. If-None-Match
+     * and If-Modified-Since are answered with 304 Not Modified. Range requests, single or
+     * multiple ranges, with If-Range, are answered with 206 or 416. Files too large for the cache are served from
+     * disk, reading only the requested ranges. A full response from the cache writes the header prepared for the
+     * variant when it was cached, followed by its content, only fields added to the response are serialized per request.
+     * Fingerprinted URLs, see fingerprintAssets(), are served as the file they were made from.
+     * \return false, leaving the response untouched, if there is no such file
+     */
+    bool serve(HttpRequest &request, HttpResponse &response) const;
+
+    /*!
+     * \brief getFileByPath reads a file under the root directory
+     * \param[in] compress the client accepts gzip
+     * \param[out] compressed set to true when fileContent is gzip encoded. Even if compress is set, the identity
+     * content is returned while the gzip variant is being produced, or when it wouldn't be smaller.
+     */
+    bool getFileByPath(const QString &path, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint = FileType::UNSPECIFIED, bool useCache = true, bool compress = false, bool *compressed = nullptr) const;
+    bool getFileByAbsolutePath(const QString &absolutePath, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint = FileType::UNSPECIFIED, bool useCache = true, bool compress = false, bool *compressed = nullptr) const;
+
+    /*!
+     * \brief setETagMode chooses between content hashes and file identities for ETags
+     *
+     * Cache items are shared by all servers, the ETag of a cached file is the one of the server that cached it.
+     */
+    void setETagMode(ETagMode etagMode)
+    {
+        m_etagMode = etagMode;
+    }
+
+    /*!
+     * \brief watch evicts cached files of this root when they change on disk, see StaticFileWatcher
+     * \param[in] prewarm also read the root into the cache in the background, compressed variants included, and
+     * read changed files back once they have been written
+     */
+    void watch(bool prewarm = false);
+
+    //! \brief prewarm reads the root into the cache on the global thread pool, up to half of the cache's capacity
+    void prewarm() const;
+
+    //! \brief refresh reads files into the cache again on the global thread pool, after they changed
+    void refresh(const QStringList &canonicalPaths) const;
+
+    //! \brief prewarmFiles does the work of prewarm() and refresh(), on the calling thread
+    void prewarmFiles(const QStringList &canonicalPaths) const;
+
+    /*!
+     * \brief useBundle makes serve() answer from a bundle made by the Pack tool instead of the root directory
+     * \return false if the file isn't a valid bundle, the server then keeps serving from its root
+     *
+     * The bundle is read when this is called, a new one is picked up by calling it again, e.g. on restart.
+     */
+    bool useBundle(const QString &fileName);
+
+    /*!
+     * \brief fingerprintAssets also serves every file at a URL fingerprinted with its content, see assetUrl()
+     *
+     * serve() answers the fingerprinted URL of a file's current content with Cache-Control: public, max-age=31536000,
+     * immutable, browsers then never revalidate it. The root is hashed once on the global thread pool, for all the
+     * servers of the root, assetUrl() returns paths unchanged until their file has been hashed. A watched root, see
+     * watch(), fingerprints files again when they change. In bundle mode the entity tags of the bundle are used, call
+     * useBundle() first.
+     */
+    void fingerprintAssets();
+
+    /*!
+     * \brief assetUrl returns the fingerprinted URL of a file, to be referenced by pages, see AssetContext
+     * \param[in] logicalPath the path of the file under the root, e.g. "/js/app.js"
+     * \return e.g. "/js/app.3fa9c1d2e4.js", or the path itself if the file isn't fingerprinted
+     */
+    QString assetUrl(const QString &logicalPath) const;
+
+    //! \brief refreshAssets fingerprints changed files and directories again on the global thread pool
+    void refreshAssets(const QStringList &canonicalPaths) const;
+
+    //! \brief fingerprintFiles does the work of fingerprintAssets() and refreshAssets(), on the calling thread
+    void fingerprintFiles(const QStringList &canonicalPaths) const;
+
+    //! \brief mimeTypeForSuffix returns the mime type of a file extension, a null string if it is unknown
+    static QString mimeTypeForSuffix(const QString &suffix);
+
+    //! \brief variantETag derives the entity tag of an encoded variant from the one of the file
+    static QString variantETag(const QString &etag, ContentEncoding encoding);
+
+    /*!
+     * \brief prepareHeader serializes the header of a full 200 response for a variant, see HttpResponse::prepareHeader()
+     * \param[in] varies the file has, or may have, other encodings, responses then carry Vary: Accept-Encoding
+     */
+    static QByteArray prepareHeader(qint64 contentLength, const QString &mimeType, ContentEncoding encoding,
+                                    const QString &etag, const QDateTime &lastModified, bool varies);
+
 private:
     FileType guessFileType(const QByteArray &fileContent) const;
+    bool isInsideRoot(const QString &canonicalPath) const;
+    bool resolve(const QString &absolutePath, bool insideRoot, StaticFileMetadataCache::Metadata &metadata) const;
+    bool serveUncached(HttpRequest &request, HttpResponse &response, const StaticFileMetadataCache::Metadata &resolved) const;
+    bool serveBundled(HttpRequest &request, HttpResponse &response, const QString &path, bool immutable) const;
+    void fingerprintFile(const QFileInfo &fileInfo, AssetManifest &manifest) const;
+    bool getFile(const QString &absolutePath, bool insideRoot, QByteArray &fileContent, QString &mimeType, QString &md5, FileType fileTypeHint, bool useCache, bool compress, bool *compressed) const;
+    const QSharedPointer<FileCacheItem> &findItem(const QString &canonicalFilePath, FileType fileTypeHint, QSharedPointer<FileCacheItem> &created) const;
+    QSharedPointer<FileCacheItem> createItem(const QFileInfo &fileInfo, FileType fileTypeHint) const;
+    void insertItem(const QString &canonicalFilePath, const QSharedPointer<FileCacheItem> &item) const;
+    bool cacheFile(const QFileInfo &fileInfo) const;
+    ContentEncoding selectEncoding(const QSharedPointer<FileCacheItem> &item, const QString &canonicalFilePath, const QVector<ContentEncoding> &acceptedEncodings) const;
+    bool readFile(const QFileInfo &fileInfo, QByteArray &fileContent, QString &mimeType, FileType fileTypeHint) const;
+    static QString fileIdentity(const QString &filePath);
+    static QString fileIdentityETag(const QString &filePath);
     static QHash<QString, QString> m_mimeTypeMap;
-    static QMutex m_fileCacheMutex;
-    static QCache<QString, FileCacheItem> m_fileCache;
 };
 
 #endif // STATICFILESERVER_H
@@ -0,0 +1,211 @@
+#include "StaticFileWatcher.h"
+#include "StaticFileServer.h"
+#include "StaticFileCache.h"
+#include "StaticFileMetadataCache.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStringBuilder>
+
+// deployments write many files in a burst, they are read back once the burst is over
+static const int refreshDelayInMilliseconds = 500;
+
+StaticFileWatcher::StaticFileWatcher()
+    :m_thread(),
+      m_watcher(new QFileSystemWatcher()),
+      m_refreshTimer(new QTimer(m_watcher)),
+      m_roots(),
+      m_watchedFiles(),
+      m_pendingRefresh(),
+      m_pendingAssets()
+{
+    m_refreshTimer->setSingleShot(true);
+    m_refreshTimer->setInterval(refreshDelayInMilliseconds);
+
+    QObject::connect(m_watcher, &QFileSystemWatcher::directoryChanged, m_watcher, [this](const QString &path){ onDirectoryChanged(path); });
+    QObject::connect(m_watcher, &QFileSystemWatcher::fileChanged, m_watcher, [this](const QString &path){ onFileChanged(path); });
+    QObject::connect(m_refreshTimer, &QTimer::timeout, m_watcher, [this](){ refreshPending(); });
+
+    m_thread.setObjectName("StaticFileWatcher");
+    m_watcher->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+StaticFileWatcher::~StaticFileWatcher()
+{
+    m_thread.quit();
+    m_thread.wait();
+    delete m_watcher;
+}
+
+void StaticFileWatcher::watchRoot(const StaticFileServer &server, const QString &canonicalRootPath, bool prewarm)
+{
+    QSharedPointer<StaticFileServer> copy(new StaticFileServer(server));
+
+    QMetaObject::invokeMethod(m_watcher, [this, copy, canonicalRootPath, prewarm](){
+        if (m_roots.contains(canonicalRootPath))
+        {
+            return;
+        }
+
+        Root root;
+        root.m_server = copy;
+        root.m_prewarm = prewarm;
+        m_roots.insert(canonicalRootPath, root);
+
+        watchDirectories(canonicalRootPath);
+
+        if (prewarm)
+        {
+            copy->prewarm();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void StaticFileWatcher::watchFile(const QString &canonicalPath)
+{
+    QMetaObject::invokeMethod(m_watcher, [this, canonicalPath](){
+        if (rootOf(canonicalPath) && !m_watchedFiles.contains(canonicalPath) && m_watcher->addPath(canonicalPath))
+        {
+            m_watchedFiles.insert(canonicalPath);
+        }
+    }, Qt::QueuedConnection);
+}
+
+void StaticFileWatcher::watchDirectories(const QString &canonicalDirectoryPath)
+{
+    QStringList directories;
+    directories.push_back(canonicalDirectoryPath);
+
+    QDirIterator iter(canonicalDirectoryPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (iter.hasNext())
+    {
+        directories.push_back(iter.next());
+    }
+
+    QStringList watched = m_watcher->directories();
+    QStringList added;
+
+    for(int i = 0; i < directories.size(); ++i)
+    {
+        if (!watched.contains(directories[i]))
+        {
+            added.push_back(directories[i]);
+        }
+    }
+
+    if (!added.isEmpty())
+    {
+        m_watcher->addPaths(added);
+    }
+}
+
+void StaticFileWatcher::onDirectoryChanged(const QString &canonicalDirectoryPath)
+{
+    const Root *root = rootOf(canonicalDirectoryPath);
+
+    if (!root)
+    {
+        return;
+    }
+
+    StaticFileMetadataCache::getSingleton().invalidate();
+
+    // the event doesn't tell which entry changed, every file cached from this directory is dropped
+    QStringList removed = StaticFileCache::getSingleton().removeDirectory(canonicalDirectoryPath);
+
+    if (QFileInfo(canonicalDirectoryPath).isDir())
+    {
+        // new subdirectories need watching as well
+        watchDirectories(canonicalDirectoryPath);
+    }
+
+    // new files, renamed ones, or the directory itself gone
+    m_pendingAssets.insert(canonicalDirectoryPath);
+    m_refreshTimer->start();
+
+    if (root->m_prewarm && !removed.isEmpty())
+    {
+        for(int i = 0; i < removed.size(); ++i)
+        {
+            m_pendingRefresh.insert(removed[i]);
+        }
+        m_refreshTimer->start();
+    }
+}
+
+void StaticFileWatcher::onFileChanged(const QString &canonicalPath)
+{
+    const Root *root = rootOf(canonicalPath);
+
+    StaticFileMetadataCache::getSingleton().invalidate();
+    StaticFileCache::getSingleton().remove(canonicalPath);
+
+    // a replaced file is a new inode, it is watched again when it gets cached again
+    m_watchedFiles.remove(canonicalPath);
+    m_watcher->removePath(canonicalPath);
+
+    if (!root)
+    {
+        return;
+    }
+
+    m_pendingAssets.insert(canonicalPath);
+    m_refreshTimer->start();
+
+    if (root->m_prewarm)
+    {
+        m_pendingRefresh.insert(canonicalPath);
+    }
+}
+
+QHash<QString, QStringList> StaticFileWatcher::groupByRoot(const QSet<QString> &canonicalPaths) const
+{
+    QHash<QString, QStringList> pathsByRoot;
+
+    for(QSet<QString>::ConstIterator iter = canonicalPaths.constBegin(); iter != canonicalPaths.constEnd(); ++iter)
+    {
+        for(QHash<QString, Root>::ConstIterator root = m_roots.constBegin(); root != m_roots.constEnd(); ++root)
+        {
+            if (*iter == root.key() || iter->startsWith(root.key() % "/"))
+            {
+                pathsByRoot[root.key()].push_back(*iter);
+                break;
+            }
+        }
+    }
+
+    return pathsByRoot;
+}
+
+void StaticFileWatcher::refreshPending()
+{
+    QHash<QString, QStringList> pathsByRoot = groupByRoot(m_pendingRefresh);
+    m_pendingRefresh.clear();
+
+    for(QHash<QString, QStringList>::ConstIterator iter = pathsByRoot.constBegin(); iter != pathsByRoot.constEnd(); ++iter)
+    {
+        m_roots[iter.key()].m_server->refresh(iter.value());
+    }
+
+    // does nothing for roots without fingerprinted assets
+    pathsByRoot = groupByRoot(m_pendingAssets);
+    m_pendingAssets.clear();
+
+    for(QHash<QString, QStringList>::ConstIterator iter = pathsByRoot.constBegin(); iter != pathsByRoot.constEnd(); ++iter)
+    {
+        m_roots[iter.key()].m_server->refreshAssets(iter.value());
+    }
+}
+
+const StaticFileWatcher::Root *StaticFileWatcher::rootOf(const QString &canonicalPath) const
+{
+    for(QHash<QString, Root>::ConstIterator iter = m_roots.constBegin(); iter != m_roots.constEnd(); ++iter)
+    {
+        if (canonicalPath == iter.key() || canonicalPath.startsWith(iter.key() % "/"))
+        {
+            return &iter.value();
+        }
+    }
+
+    return nullptr;
+}
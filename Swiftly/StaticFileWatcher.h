@@ -0,0 +1,75 @@
+#ifndef STATICFILEWATCHER_H
+#define STATICFILEWATCHER_H
+
+#include <QThread>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class StaticFileServer;
+
+/*! \brief StaticFileWatcher invalidates cached static files when they change on disk
+ *
+ * Watching runs on one thread shared by all StaticFileServer roots, with QFileSystemWatcher, which is backed by
+ * inotify on Linux and kqueue on macOS. Every directory under a root is watched, for files created, deleted or
+ * renamed into place, the way deployments usually replace assets. Cached files are watched too, for in place writes.
+ * A change evicts the affected entries, and every resolved path of StaticFileMetadataCache, right away. If the root was registered with prewarming, the evicted files are
+ * read back into the cache once the directory has been quiet for a moment, so that a deployment doesn't leave a cold
+ * cache behind. Roots with fingerprinted assets, see StaticFileServer::fingerprintAssets(), get changed files and
+ * directories fingerprinted again at the same time.
+ */
+class StaticFileWatcher
+{
+    class Root
+    {
+    public:
+        QSharedPointer<StaticFileServer> m_server;
+        bool m_prewarm;
+    };
+
+    QThread m_thread;
+    // lives on m_thread, so do the members below, they are only touched from there
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_refreshTimer;
+    QHash<QString, Root> m_roots;
+    QSet<QString> m_watchedFiles;
+    QSet<QString> m_pendingRefresh;
+    // files and directories whose fingerprints may be stale
+    QSet<QString> m_pendingAssets;
+
+    StaticFileWatcher();
+    ~StaticFileWatcher();
+
+    void watchDirectories(const QString &canonicalDirectoryPath);
+    void onDirectoryChanged(const QString &canonicalDirectoryPath);
+    void onFileChanged(const QString &canonicalPath);
+    void refreshPending();
+    QHash<QString, QStringList> groupByRoot(const QSet<QString> &canonicalPaths) const;
+    const Root *rootOf(const QString &canonicalPath) const;
+
+public:
+    static StaticFileWatcher &getSingleton()
+    {
+        static StaticFileWatcher obj;
+        return obj;
+    }
+
+    /*!
+     * \brief watchRoot starts watching the root directory of a static file server, registering it again does nothing
+     * \param[in] server the server, a copy is kept to read changed files back into the cache
+     * \param[in] canonicalRootPath the canonical path of the server's root
+     * \param[in] prewarm read the root into the cache now, and changed files once they are written
+     */
+    void watchRoot(const StaticFileServer &server, const QString &canonicalRootPath, bool prewarm);
+
+    /*!
+     * \brief watchFile watches a file that has just been cached, for changes made without replacing it
+     */
+    void watchFile(const QString &canonicalPath);
+};
+
+#endif // STATICFILEWATCHER_H
@@ -8,6 +8,8 @@
 #include "ReCAPTCHAVerifier.h"
 #include <QSettings>
 #include "SettingsManager.h"
+#include "MemoryPressureMonitor.h"
+#include "SessionManager.h"
 #include <QCryptographicHash>
 #include <QStringBuilder>
 
@@ -15,8 +17,11 @@ HttpServer::HttpServer(QObject* parent )
     : QTcpServer(parent), 
       m_connectionCount(0),
       m_disabled(false),
+      m_sharedRouteTable(false),
       m_incomingConnectionQueue(nullptr),
-      m_webAppSet()
+      m_webAppSet(),
+      m_workerPool(),
+      m_sharedWebApps()
 
 {
     qRegisterMetaType<qintptr>("qintptr");
@@ -30,6 +35,9 @@ HttpServer::HttpServer(QObject* parent )
 
 HttpServer::~HttpServer()
 {
+    // the workers dispatch into the shared WebApps through the shared route tree, they must be gone first
+    stopWorkers();
+    qDeleteAll(m_sharedWebApps);
 }
 
 void HttpServer::incomingConnection(qintptr socket)
@@ -62,6 +70,8 @@ void HttpServer::start(int numOfWorkers, quint16 port)
         ReCAPTCHAVerifier::getSingleton().init(secret);
     }
 
+    MemoryPressureMonitor::getSingleton().start();
+
     QString adminPassHash;
     QString consolePath;
 
@@ -79,11 +89,27 @@ void HttpServer::start(int numOfWorkers, quint16 port)
         numOfWorkers=1;
     }
 
+    QSharedPointer<PathTree> sharedPathTree;
+
+    if (m_sharedRouteTable)
+    {
+        sharedPathTree = buildSharedRouteTable();
+    }
+
     for(int i=0;i<numOfWorkers;++i)
     {
         Worker *aWorker=new Worker(QString("worker %1").arg(i), m_incomingConnectionQueue, consolePath, adminPassHash);
         aWorker->moveToThread(aWorker);
-        aWorker->registerWebApps(m_webAppSet);
+
+        if (m_sharedRouteTable)
+        {
+            aWorker->setPathTree(sharedPathTree);
+        }
+        else
+        {
+            aWorker->registerWebApps(m_webAppSet);
+        }
+
         aWorker->start();
         aWorker->setPriority(QThread::HighPriority);
         connect(aWorker, SIGNAL(shutdown()), this, SLOT(shutdown()));
@@ -95,10 +121,34 @@ void HttpServer::start(int numOfWorkers, quint16 port)
     qDebug()<<"Start listening! main ThreadId"<<thread()->currentThreadId();
 }
 
-void HttpServer::shutdown()
+QSharedPointer<PathTree> HttpServer::buildSharedRouteTable()
 {
-    close();
-    m_disabled = true;
+    QSharedPointer<PathTree> pathTree(new PathTree());
+
+    for(int i=0;i<m_webAppSet.count();++i)
+    {
+        WebApp *app = static_cast<WebApp*> (QMetaType::create(m_webAppSet[i], nullptr));
+
+        app->setPathTree(pathTree);
+
+        app->registerPathHandlers();
+
+        app->init();
+
+        m_sharedWebApps.push_back(app);
+    }
+
+    qDebug() << "shared route table built for" << m_sharedWebApps.count() << "web apps";
+
+    return pathTree;
+}
+
+void HttpServer::stopWorkers()
+{
+    if (m_workerPool.isEmpty())
+    {
+        return;
+    }
 
     for(int i =0;i<m_workerPool.size()+2;++i)
     {
@@ -110,7 +160,22 @@ void HttpServer::shutdown()
         m_workerPool[i]->wait();
     }
 
+    // stopped once, whether by shutdown() or the destructor
+    m_workerPool.clear();
+}
+
+void HttpServer::shutdown()
+{
+    close();
+    m_disabled = true;
+
+    stopWorkers();
+
     qDebug() << "all worker finished!";
+
+    // nothing touches sessions anymore, and the database client is still there, unlike in static destructors
+    SessionManager::shutdown();
+
     QCoreApplication::quit();
 }
 
@@ -21,12 +21,17 @@ class HttpServer : public QTcpServer
 
     int m_connectionCount;
     bool m_disabled;
+    bool m_sharedRouteTable;
     IncomingConnectionQueue *m_incomingConnectionQueue;
 
     QVector<int> m_webAppSet;
     QVector<Worker*> m_workerPool;
+    QVector<WebApp*> m_sharedWebApps;
 
     void incomingConnection(qintptr handle) override;
+    QSharedPointer<PathTree> buildSharedRouteTable();
+    //! \brief stopWorkers ends the workers' threads and waits for them
+    void stopWorkers();
 public:
     HttpServer(QObject* parent = nullptr);
     virtual ~HttpServer() override;
@@ -37,6 +42,21 @@ public:
         return obj;
     }
 
+    /*!
+     * \brief setSharedRouteTable chooses how WebApps are instantiated
+     * \param[in] shared true to build every WebApp and the route tree once for all workers
+     *
+     * By default every worker creates its own instance of each registered WebApp and its own route tree.
+     * In shared mode, each WebApp is created, registered and initialized only once, and all workers route
+     * into the same read-only PathTree. Handlers then run concurrently on one instance, so a WebApp
+     * that keeps non thread safe members should move them into WebApp::workerState().
+     * Must be called before start().
+     */
+    void setSharedRouteTable(bool shared)
+    {
+        m_sharedRouteTable = shared;
+    }
+
     void start(int numOfWorkers, quint16 port);
     void pause();
     void resume();
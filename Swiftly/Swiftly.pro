@@ -31,14 +31,37 @@ HEADERS += Swiftly.h \
     HttpResponse.h \
     PathTree.h \
     PathTreeNode.h \
+    TaskHandler.h \
+    Middleware.h \
+    Compression.h \
+    Checksum.h \
+    ResponseCache.h \
+    RequestCoalescer.h \
     TcpSocket.h \
     WebApp.h \
     Worker.h \
     StaticFileServer.h \
+    StaticFileCache.h \
+    StaticBundle.h \
+    MemoryPressureMonitor.h \
+    FrequencySketch.h \
+    StaticFileWatcher.h \
+    StaticFileMetadataCache.h \
+    StaticFileArtifactCache.h \
+    AssetManifest.h \
+    AssetContext.h \
+    MappedFile.h \
     IncomingConnectionQueue.h \
     WorkerSocketWatchDog.h \
     UserManager.h \
     SessionManager.h \
+    SessionCache.h \
+    SessionTouchBuffer.h \
+    SessionTokenSigner.h \
+    SessionStore.h \
+    MemorySessionStore.h \
+    MongoSessionStore.h \
+    TieredSessionStore.h \
     MongodbManager.h \
     ReCAPTCHAVerifier.h \
     SettingsManager.h \
@@ -62,24 +85,48 @@ SOURCES += \
     Worker.cpp \
     ../http-parser/http_parser.c \
     StaticFileServer.cpp \
+    StaticFileCache.cpp \
+    StaticBundle.cpp \
+    MemoryPressureMonitor.cpp \
+    FrequencySketch.cpp \
+    StaticFileWatcher.cpp \
+    StaticFileMetadataCache.cpp \
+    StaticFileArtifactCache.cpp \
+    AssetManifest.cpp \
+    AssetContext.cpp \
+    MappedFile.cpp \
     IncomingConnectionQueue.cpp \
     WorkerSocketWatchDog.cpp \
     UserManager.cpp \
     SessionManager.cpp \
+    SessionCache.cpp \
+    SessionTouchBuffer.cpp \
+    SessionTokenSigner.cpp \
+    SessionStore.cpp \
+    MemorySessionStore.cpp \
+    MongoSessionStore.cpp \
+    TieredSessionStore.cpp \
     MongodbManager.cpp \
     ReCAPTCHAVerifier.cpp \
     SettingsManager.cpp \
     SmtpManager.cpp \
-    NetworkServiceAccessor.cpp
+    NetworkServiceAccessor.cpp \
+    Middleware.cpp \
+    Compression.cpp \
+    Checksum.cpp \
+    ResponseCache.cpp \
+    RequestCoalescer.cpp
 
 LIBS += -L/usr/local/lib -lsodium
 LIBS += -L/Users/shiyan/mongodb/mongo-cxx-driver/build/install/lib
 LIBS += -lmongocxx
 LIBS += -lbsoncxx
 
+include(Compression.pri)
 include(../qt-mustache/qt-mustache.pri)
 include(../LoggingManager/LoggingManager/LoggingManager.pri)
 
-DISTFILES +=
+DISTFILES += \
+    Compression.pri
 
 RESOURCES +=
@@ -0,0 +1,90 @@
+#ifndef TASKHANDLER_H
+#define TASKHANDLER_H
+
+class HttpRequest;
+class HttpResponse;
+
+/*! \brief TaskHandler is what the route tree stores for each path and verb
+ *
+ * It is a plain function pointer plus the object it should be invoked on, so dispatching a request
+ * costs one direct call and no allocation. Member function handlers are bound at compile time with
+ * fromMethod(), the function pointer is an instantiation of invokeMethod() for that very method.
+ */
+class TaskHandler
+{
+public:
+    typedef void (*Invoker)(void *object, HttpRequest &, HttpResponse &);
+
+    template<typename T>
+    struct MethodTraits;
+
+    template<typename C>
+    struct MethodTraits<void (C::*)(HttpRequest &, HttpResponse &)>
+    {
+        typedef C Class;
+    };
+
+private:
+    void *m_object;
+    Invoker m_invoker;
+
+    template<auto Method>
+    static void invokeMethod(void *object, HttpRequest &request, HttpResponse &response)
+    {
+        typedef typename MethodTraits<decltype(Method)>::Class Class;
+        (static_cast<Class*>(object)->*Method)(request, response);
+    }
+
+    template<auto Method, typename Chain>
+    static void invokeMethodThrough(void *object, HttpRequest &request, HttpResponse &response)
+    {
+        Chain::run(request, response, [object](HttpRequest &request, HttpResponse &response){
+            invokeMethod<Method>(object, request, response);
+        });
+    }
+
+public:
+    TaskHandler()
+        :m_object(nullptr),
+          m_invoker(nullptr)
+    {}
+
+    TaskHandler(void *object, Invoker invoker)
+        :m_object(object),
+          m_invoker(invoker)
+    {}
+
+    /*!
+     * \brief fromMethod binds a handler member function to the object it will be called on
+     * \param[in] object the WebApp instance that owns the handler
+     * \return the handler, e.g. TaskHandler::fromMethod<&HelloWorld::handleHelloWorldGet>(this)
+     */
+    template<auto Method>
+    static TaskHandler fromMethod(typename MethodTraits<decltype(Method)>::Class *object)
+    {
+        return TaskHandler(static_cast<void*>(object), &TaskHandler::invokeMethod<Method>);
+    }
+
+    /*!
+     * \brief fromMethodThrough binds a handler member function wrapped by a MiddlewareChain
+     *
+     * The chain is expanded at compile time into the trampoline, so the whole chain is still one indirect call.
+     */
+    template<auto Method, typename Chain>
+    static TaskHandler fromMethodThrough(typename MethodTraits<decltype(Method)>::Class *object)
+    {
+        return TaskHandler(static_cast<void*>(object), &TaskHandler::invokeMethodThrough<Method, Chain>);
+    }
+
+    explicit operator bool() const
+    {
+        return m_invoker != nullptr;
+    }
+
+    void operator()(HttpRequest &request, HttpResponse &response) const
+    {
+        m_invoker(m_object, request, response);
+    }
+};
+
+#endif // TASKHANDLER_H
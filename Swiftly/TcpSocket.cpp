@@ -3,6 +3,7 @@
 TcpSocket::TcpSocket(QObject *parent)
     :QTcpSocket(parent),
       m_isNew(true),
+      m_isParked(false),
       m_request(this),
       m_response(this),
       m_suicideTimer(this)
@@ -13,6 +14,7 @@ TcpSocket::TcpSocket(QObject *parent)
 TcpSocket::TcpSocket(const TcpSocket &in)
     :QTcpSocket(),
       m_isNew(in.m_isNew),
+      m_isParked(in.m_isParked),
       m_request(in.m_request),
       m_response(in.m_response),
       m_suicideTimer(this)
@@ -24,6 +26,7 @@ TcpSocket::TcpSocket(const TcpSocket &in)
 void TcpSocket::operator=(const TcpSocket &in)
 {
     m_isNew=in.m_isNew;
+    m_isParked=in.m_isParked;
     m_request=in.m_request;
     m_response=in.m_response;
 }
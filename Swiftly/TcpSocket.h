@@ -12,6 +12,7 @@ class TcpSocket:public QTcpSocket
     Q_OBJECT
 
     bool m_isNew;
+    bool m_isParked;
 
     HttpRequest m_request;
     HttpResponse m_response;
@@ -34,6 +35,18 @@ public:
     void notNew();
 
     bool isNewSocket();
+
+    //! a parked socket waits for a deferred response, or streams a mapped body, its worker already counts it as idle
+    void park()
+    {
+        m_isParked = true;
+    }
+
+    bool isParked() const
+    {
+        return m_isParked;
+    }
+
     void setTotalBytes(unsigned int _totalBytes);
 
     void appendData(const char* buffer,unsigned int size);
@@ -0,0 +1,59 @@
+#include "TieredSessionStore.h"
+
+TieredSessionStore::TieredSessionStore(SessionStore *front, SessionStore *back)
+    :SessionStore(),
+      m_front(front),
+      m_back(back)
+{
+}
+
+void TieredSessionStore::initialize()
+{
+    m_front->initialize();
+    m_back->initialize();
+}
+
+void TieredSessionStore::shutdown()
+{
+    m_front->shutdown();
+    m_back->shutdown();
+}
+
+bool TieredSessionStore::insert(const QByteArray &sessionId, const Session &session)
+{
+    if (!m_back->insert(sessionId, session))
+    {
+        return false;
+    }
+
+    m_front->insert(sessionId, session);
+    return true;
+}
+
+bool TieredSessionStore::find(const QByteArray &sessionId, Session &session)
+{
+    if (m_front->find(sessionId, session))
+    {
+        return true;
+    }
+
+    if (!m_back->find(sessionId, session))
+    {
+        return false;
+    }
+
+    m_front->insert(sessionId, session);
+    return true;
+}
+
+bool TieredSessionStore::remove(const QByteArray &sessionId)
+{
+    m_front->remove(sessionId);
+    return m_back->remove(sessionId);
+}
+
+void TieredSessionStore::touch(const QByteArray &sessionId, qint64 time)
+{
+    m_front->touch(sessionId, time);
+    m_back->touch(sessionId, time);
+}
@@ -0,0 +1,35 @@
+#ifndef TIEREDSESSIONSTORE_H
+#define TIEREDSESSIONSTORE_H
+
+#include "SessionStore.h"
+#include <QScopedPointer>
+
+/*! \brief TieredSessionStore answers from a local store first, and keeps a shared one up to date behind it
+ *
+ * Lookups missing the front are read from the back and copied to the front. Inserts and removals go to both, the back
+ * decides whether an insert succeeds. Sessions survive a restart through the back, but a session removed by another
+ * process stays valid in this one until it times out, use it for single instance deployments.
+ */
+class TieredSessionStore : public SessionStore
+{
+    QScopedPointer<SessionStore> m_front;
+    QScopedPointer<SessionStore> m_back;
+
+public:
+    //! \param[in] front, back the stores, owned by the tiered store from now on
+    TieredSessionStore(SessionStore *front, SessionStore *back);
+
+    void initialize() override;
+    void shutdown() override;
+    bool insert(const QByteArray &sessionId, const Session &session) override;
+    bool find(const QByteArray &sessionId, Session &session) override;
+    bool remove(const QByteArray &sessionId) override;
+    void touch(const QByteArray &sessionId, qint64 time) override;
+
+    bool isRemote() const override
+    {
+        return m_front->isRemote();
+    }
+};
+
+#endif // TIEREDSESSIONSTORE_H
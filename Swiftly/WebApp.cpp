@@ -29,3 +29,13 @@ bool WebApp::addPostHandler(const QString &_path, const std::function<void (Http
 
     return m_pathTree->registerAPath(path,in,PathTreeNode::POST);
 }
+
+bool WebApp::addHandler(const QString &_path, const TaskHandler &in, enum PathTreeNode::HttpVerb verb)
+{
+    QString path=_path;
+
+    if(!m_pathSpace.isEmpty())
+        path='/' + m_pathSpace + _path;
+
+    return m_pathTree->registerAPath(path, in, verb);
+}
@@ -2,16 +2,17 @@
 #define WEBAPP_H
 
 #include <QObject>
+#include <QThreadStorage>
 #include "HttpResponse.h"
 #include "HttpRequest.h"
 #include "PathTree.h"
-#include "HttpRequest.h"
+#include "Middleware.h"
 
 #define AddGetHandler(path, func) \
- addGetHandler( path, [&](HttpRequest &request, HttpResponse &response){ func (request, response);});
+ addGet<&std::remove_reference<decltype(*this)>::type::func>( path );
 
 #define AddPostHandler(path, func) \
- addPostHandler( path, [&](HttpRequest &request, HttpResponse &response){ func (request, response);});
+ addPost<&std::remove_reference<decltype(*this)>::type::func>( path );
 
 template <typename E>
 constexpr typename std::underlying_type<E>::type to_underlying(E e) {
@@ -26,6 +27,10 @@ class WebApp:public QObject
 
     QSharedPointer<PathTree> m_pathTree;
 
+    QThreadStorage<QObject*> m_workerState;
+
+    bool addHandler(const QString &_path, const TaskHandler &in, enum PathTreeNode::HttpVerb verb);
+
 public:
     WebApp(const QString &_pathSpace="",QObject *parent = nullptr);
     WebApp(const WebApp &in):QObject(),m_pathSpace(in.m_pathSpace),m_pathTree(in.m_pathTree){}
@@ -33,6 +38,34 @@ public:
     bool addGetHandler(const QString &_path, const std::function<void (HttpRequest &, HttpResponse &)> &in);
     bool addPostHandler(const QString &_path, const std::function<void (HttpRequest &, HttpResponse &)> &in);
 
+    /*!
+     * \brief addGet registers a member function as the GET handler of a path
+     * \param[in] _path the path, relative to the path space of this WebApp
+     * \return true on success
+     *
+     * The handler is bound at compile time, e.g. addGet<&MyApp::handleIndexGet>("/"). The route tree
+     * stores a function pointer and this object, requests are dispatched without std::function.
+     *
+     * Middlewares listed after the handler, e.g. addGet<&MyApp::handleIndexGet, TimingMiddleware>("/"), run for
+     * this route after the ones the WebApp declares for all its routes (see MiddlewareChain).
+     */
+    template<auto Method, typename... Middlewares>
+    bool addGet(const QString &_path)
+    {
+        typedef typename TaskHandler::MethodTraits<decltype(Method)>::Class Class;
+        typedef typename WebAppMiddlewares<Class>::Chain::template Append<Middlewares...> Chain;
+        return addHandler(_path, TaskHandler::fromMethodThrough<Method, Chain>(static_cast<Class*>(this)), PathTreeNode::GET);
+    }
+
+    //! \brief addPost registers a member function as the POST handler of a path, see addGet()
+    template<auto Method, typename... Middlewares>
+    bool addPost(const QString &_path)
+    {
+        typedef typename TaskHandler::MethodTraits<decltype(Method)>::Class Class;
+        typedef typename WebAppMiddlewares<Class>::Chain::template Append<Middlewares...> Chain;
+        return addHandler(_path, TaskHandler::fromMethodThrough<Method, Chain>(static_cast<Class*>(this)), PathTreeNode::POST);
+    }
+
     virtual ~WebApp(){}
 
     const QString & getPathSpace()
@@ -54,6 +87,33 @@ public:
 protected:
     void logOffSession(HttpRequest & request);
 
+    /*!
+     * \brief createWorkerState override this to create the state a WebApp needs per worker thread
+     * \return a new state object, owned by the calling worker thread, or nullptr if the app has no per worker state
+     *
+     * When the route table is shared (see HttpServer::setSharedRouteTable()), only one instance of the WebApp
+     * serves all workers. Members that aren't thread safe, e.g. a QNetworkAccessManager, should be created here instead.
+     * This is called lazily, the first time workerState() is used on a worker thread.
+     */
+    virtual QObject *createWorkerState()
+    {
+        return nullptr;
+    }
+
+    /*!
+     * \brief workerState returns the state created by createWorkerState() for the current worker thread
+     */
+    template<typename T>
+    T *workerState()
+    {
+        if (!m_workerState.hasLocalData())
+        {
+            m_workerState.setLocalData(createWorkerState());
+        }
+
+        return static_cast<T*>(m_workerState.localData());
+    }
+
 
 };
 
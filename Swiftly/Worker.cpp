@@ -13,6 +13,13 @@
 #include <QHostAddress>
 #include <QCryptographicHash>
 #include "AdminPageContent.h"
+#include "StaticFileCache.h"
+#include "MemoryPressureMonitor.h"
+#include "SessionCache.h"
+#include "SessionTouchBuffer.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
 
 int onMessageBegin(http_parser *)
 {
@@ -172,6 +179,8 @@ Worker::Worker(const QString &name, IncomingConnectionQueue *connectionQueue, co
       m_consolePath(consolePath),
       m_adminPassHash(adminPassHash)
 {
+    // names the thread in debuggers and in the cache statistics
+    setObjectName(name);
 }
 
 Worker::~Worker()
@@ -302,47 +311,87 @@ void Worker::readClient()
             socket->getRequest().processCookies();
             socket->getRequest().parseFormData();
 
-            //qDebug() << "path" << socket->getRequest().getHeader().getPath();
+            dispatch(socket, handlerType);
+        }
+        else
+        {
+            qDebug()<<"socket size:"<<socket->getTotalBytes()<<"current size:"<<socket->getBytesHaveRead();
+            return;
+        }
+    }
+}
+
+void Worker::dispatch(TcpSocket *socket, PathTreeNode::HttpVerb handlerType)
+{
+    //qDebug() << "path" << socket->getRequest().getHeader().getPath();
 #ifndef NO_LOG
-            sLog() << "handle request:" << socket->getRequest().getHeader().getPath();
-            qDebug() << "handle request:" << socket->getRequest().getHeader().getPath();
+    sLog() << "handle request:" << socket->getRequest().getHeader().getPath();
+    qDebug() << "handle request:" << socket->getRequest().getHeader().getPath();
 #endif
-            if (!m_consolePath.isEmpty() && m_consolePath == socket->getRequest().getHeader().getPath())
-            {
-                handleConsole(socket->getRequest(), socket->getResponse());
-                socket->getResponse().finish();
-            }
-            else
-            {
-                const std::function<void (HttpRequest &, HttpResponse &)> &th = m_pathTree->getTaskHandlerByPath(socket->getRequest().getHeader().getPath(), handlerType);
+    if (!m_consolePath.isEmpty() && m_consolePath == socket->getRequest().getHeader().getPath())
+    {
+        handleConsole(socket->getRequest(), socket->getResponse());
+        socket->getResponse().finish();
+    }
+    else
+    {
+        const TaskHandler &th = m_pathTree->getTaskHandlerByPath(socket->getRequest().getHeader().getPath(), handlerType);
 
-                if(th)
-                {
-                    th(socket->getRequest(), socket->getResponse());
-                    socket->getResponse().finish();
-                }
-                else
+        if(th)
+        {
+            th(socket->getRequest(), socket->getResponse());
+
+            if (socket->getResponse().isDeferred())
+            {
+                // a middleware parked the request, whoever completes it writes and closes the socket.
+                // Meanwhile this worker can take new connections, a request resumed by RequestCoalescer already counts
+                // as idle.
+                if (!socket->isParked())
                 {
-#ifndef NO_LOG
-                    qDebug()<<"empty task handler!" << socket->getRequest().getHeader().getPath() << ";" <<handlerType;
-                    sLog()<<"empty task handler!" << socket->getRequest().getHeader().getPath() << ";" <<handlerType;
-#endif
-                    socket->getResponse().setStatusCode(404);
-                    socket->getResponse().finish();
+                    socket->park();
+                    m_idleSemaphore.release();
                 }
+                return;
             }
 
-            socket->waitForBytesWritten();
-            socket->close();
+            socket->getResponse().finish();
         }
         else
         {
-            qDebug()<<"socket size:"<<socket->getTotalBytes()<<"current size:"<<socket->getBytesHaveRead();
-            return;
+#ifndef NO_LOG
+            qDebug()<<"empty task handler!" << socket->getRequest().getHeader().getPath() << ";" <<handlerType;
+            sLog()<<"empty task handler!" << socket->getRequest().getHeader().getPath() << ";" <<handlerType;
+#endif
+            socket->getResponse().setStatusCode(404);
+            socket->getResponse().finish();
+        }
+    }
+
+    if (socket->getResponse().isStreaming())
+    {
+        // the rest of a mapped body goes out as the client reads, the response disconnects the socket then.
+        // Meanwhile this worker can take new connections, as for a parked request.
+        if (!socket->isParked())
+        {
+            socket->park();
+            m_idleSemaphore.release();
         }
+        return;
     }
+
+    socket->waitForBytesWritten();
+    socket->close();
 }
 
+void Worker::resumeParked(TcpSocket *socket)
+{
+    // the first run left its state in the response, the handler chain starts over from a clean one,
+    // and runs the handler itself this time
+    socket->getResponse() = HttpResponse(socket);
+    socket->getRequest().setCoalescable(false);
+
+    dispatch(socket, socket->getHeader().getHttpMethod() == HttpHeader::HttpMethod::HTTP_POST ? PathTreeNode::POST : PathTreeNode::GET);
+}
 
 void Worker::registerWebApps(QVector<int> &webAppClassIDs)
 {
@@ -360,6 +409,11 @@ void Worker::registerWebApps(QVector<int> &webAppClassIDs)
     }
 }
 
+void Worker::setPathTree(const QSharedPointer<PathTree> &pathTree)
+{
+    m_pathTree = pathTree;
+}
+
 void Worker::discardClient()
 {
     TcpSocket* socket = static_cast<TcpSocket*>(sender());
@@ -371,7 +425,11 @@ void Worker::discardClient()
     sLogFlush();
 #endif
     socket->deleteLater();
-    m_idleSemaphore.release();
+
+    if (!socket->isParked())
+    {
+        m_idleSemaphore.release();
+    }
 }
 
 void Worker::run()
@@ -403,6 +461,73 @@ void Worker::watchDogFinished()
     quit();
 }
 
+QJsonObject Worker::cacheStatistics() const
+{
+    StaticFileCache &cache = StaticFileCache::getSingleton();
+    QJsonArray workers;
+    QVector<const StaticFileCache::Statistics*> statistics = cache.statistics();
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 bytesSent = 0;
+    quint64 bytesSaved = 0;
+
+    for(int i = 0; i < statistics.size(); ++i)
+    {
+        quint64 l1Hits = statistics[i]->m_l1Hits.load();
+        quint64 l2Hits = statistics[i]->m_l2Hits.load();
+        quint64 workerMisses = statistics[i]->m_misses.load();
+        quint64 lookups = l1Hits + l2Hits + workerMisses;
+
+        hits += l1Hits + l2Hits;
+        misses += workerMisses;
+        bytesSent += statistics[i]->m_bytesSent.load();
+        bytesSaved += statistics[i]->m_bytesSaved.load();
+
+        QJsonObject worker;
+        worker["name"] = statistics[i]->m_threadName;
+        worker["l1Hits"] = static_cast<double>(l1Hits);
+        worker["l2Hits"] = static_cast<double>(l2Hits);
+        worker["misses"] = static_cast<double>(workerMisses);
+        worker["l1HitRatio"] = lookups ? static_cast<double>(l1Hits) / lookups : 0.0;
+        worker["l2HitRatio"] = lookups ? static_cast<double>(l2Hits) / lookups : 0.0;
+        workers.append(worker);
+    }
+
+    StaticFileCache::Usage usage = cache.usage();
+
+    QJsonObject result;
+    result["entries"] = usage.m_entries;
+    result["bytes"] = static_cast<double>(usage.m_costInKB * 1024);
+    result["capacityBytes"] = static_cast<double>(cache.capacityInKB() * 1024);
+    result["budgetBytes"] = static_cast<double>(cache.budgetInKB() * 1024);
+    result["memoryPressure"] = MemoryPressureMonitor::getSingleton().pressure();
+    result["hits"] = static_cast<double>(hits);
+    result["misses"] = static_cast<double>(misses);
+    result["hitRatio"] = hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    result["evictions"] = static_cast<double>(cache.evictions());
+    result["bytesSent"] = static_cast<double>(bytesSent);
+    result["compressionSavedBytes"] = static_cast<double>(bytesSaved);
+    result["workers"] = workers;
+    return result;
+}
+
+QJsonObject Worker::sessionStatistics() const
+{
+    SessionCache::Statistics statistics = SessionCache::getSingleton().statistics();
+
+    QJsonObject result;
+    result["enabled"] = SessionCache::getSingleton().isEnabled();
+    result["entries"] = statistics.m_entries;
+    result["hits"] = static_cast<double>(statistics.m_hits);
+    result["misses"] = static_cast<double>(statistics.m_misses);
+    result["hitRatio"] = statistics.m_hits + statistics.m_misses ? static_cast<double>(statistics.m_hits) / (statistics.m_hits + statistics.m_misses) : 0.0;
+    result["evictions"] = static_cast<double>(statistics.m_evictions);
+    result["touchesPending"] = SessionTouchBuffer::getSingleton().pending();
+    result["touchesWritten"] = static_cast<double>(SessionTouchBuffer::getSingleton().written());
+    result["touchFlushes"] = static_cast<double>(SessionTouchBuffer::getSingleton().flushes());
+    return result;
+}
+
 void Worker::handleConsole(HttpRequest &request, HttpResponse &response)
 {
     if (request.getHeader().getHeaderInfo().contains("swiftly-admin"))
@@ -421,6 +546,20 @@ void Worker::handleConsole(HttpRequest &request, HttpResponse &response)
                 {
                     emit shutdown();
                 }
+                else if (cmd == "cachestats")
+                {
+                    response.setStatusCode(200);
+                    response << QJsonDocument(cacheStatistics()).toJson();
+                    response.finish("application/json");
+                    return;
+                }
+                else if (cmd == "sessionstats")
+                {
+                    response.setStatusCode(200);
+                    response << QJsonDocument(sessionStatistics()).toJson();
+                    response.finish("application/json");
+                    return;
+                }
 
                 response.setStatusCode(200);
                 response << "done!";
@@ -7,9 +7,11 @@
 #include "PathTree.h"
 #include "WebApp.h"
 #include <QSemaphore>
+#include <QJsonObject>
 
 class WorkerSocketWatchDog;
 class IncomingConnectionQueue;
+class TcpSocket;
 
 class Worker : public QThread
 {
@@ -31,8 +33,17 @@ public:
     void run();
     Worker(const QString &name, IncomingConnectionQueue *connectionQueue, const QString &consolePath = QString(), const QString &adminPassHash = QString());
     void registerWebApps(QVector<int> &webAppClassIDs);
+    void setPathTree(const QSharedPointer<PathTree> &pathTree);
     void waitForIdle();
     ~Worker();
+
+    /*!
+     * \brief resumeParked runs the handler chain of a parked request again, this time without coalescing
+     *
+     * Called on the worker's thread by RequestCoalescer, when the leader's response can't be shared or a waiter has
+     * waited too long.
+     */
+    void resumeParked(TcpSocket *socket);
     qintptr getSocket();
 
 public slots:
@@ -45,7 +56,12 @@ signals:
     void shutdown();
 
 private:
+    void dispatch(TcpSocket *socket, PathTreeNode::HttpVerb handlerType);
     void handleConsole(HttpRequest &request, HttpResponse &response);
+    //! \brief cacheStatistics reports what the static file cache holds, its budget, and the hit ratios of every worker
+    QJsonObject cacheStatistics() const;
+    //! \brief sessionStatistics reports the entries and hit ratio of SessionCache, and the touches written in batches
+    QJsonObject sessionStatistics() const;
 };
 
 #endif // WORKER_H
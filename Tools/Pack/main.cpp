@@ -0,0 +1,166 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringBuilder>
+#include <climits>
+#include "Compression.h"
+#include "Checksum.h"
+#include "StaticFileServer.h"
+#include "StaticBundle.h"
+
+// Packs an asset directory into one bundle for StaticFileServer::useBundle(). Every file gets its compressed variants,
+// taken from up to date .br, .zst and .gz sidecars when there are some, its content entity tag and its mime type.
+static bool isSidecar(const QFileInfo &fileInfo)
+{
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        QString suffix = contentEncodingSuffix(static_cast<ContentEncoding>(i));
+
+        if (fileInfo.fileName().endsWith(suffix) && QFileInfo::exists(fileInfo.absoluteFilePath().left(fileInfo.absoluteFilePath().size() - suffix.size())))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// the same guess the server makes for files of unknown type, text unless there is a NUL byte early on
+static QString guessMimeType(const QByteArray &content)
+{
+    int checkLength = qMin(content.size(), 100);
+
+    for(int i = 0; i < checkLength; ++i)
+    {
+        if (content[i] == 0)
+        {
+            return "application/octet-stream";
+        }
+    }
+
+    return "text/plain";
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("Pack");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Packs an asset directory into a bundle served by StaticFileServer::useBundle().");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "The asset directory, walked recursively.");
+    parser.addPositionalArgument("bundle", "The bundle file to write.");
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 2)
+    {
+        parser.showHelp(1);
+    }
+
+    QDir root(parser.positionalArguments().at(0));
+
+    if (!root.exists())
+    {
+        err << "no such directory: " << root.path() << endl;
+        return 1;
+    }
+
+    QString rootPath = root.canonicalPath();
+    StaticBundle::Builder builder;
+    qint64 originalTotal = 0;
+    qint64 packedTotal = 0;
+
+    QDirIterator iter(rootPath, QDir::Files, QDirIterator::Subdirectories);
+
+    while (iter.hasNext())
+    {
+        QFileInfo fileInfo(iter.next());
+
+        if (isSidecar(fileInfo))
+        {
+            continue;
+        }
+
+        if (fileInfo.size() > INT_MAX)
+        {
+            err << "skipping " << fileInfo.absoluteFilePath() << ", too large for a bundle" << endl;
+            continue;
+        }
+
+        QFile file(fileInfo.absoluteFilePath());
+
+        if (!file.open(QFile::ReadOnly))
+        {
+            err << "can't read " << fileInfo.absoluteFilePath() << endl;
+            return 1;
+        }
+
+        StaticBundle::Builder::File bundled;
+        QByteArray content = file.readAll();
+        file.close();
+
+        // the path a request for the file has when the directory is the server's root
+        bundled.m_path = fileInfo.canonicalFilePath().mid(rootPath.size());
+        bundled.m_mimeType = StaticFileServer::mimeTypeForSuffix(fileInfo.suffix());
+        if (bundled.m_mimeType.isNull())
+        {
+            bundled.m_mimeType = guessMimeType(content);
+        }
+        bundled.m_etag = contentETag(content);
+        bundled.m_lastModified = fileInfo.lastModified();
+        bundled.m_content[static_cast<int>(ContentEncoding::Identity)] = content;
+
+        bool worthCompressing = isWorthCompressing(bundled.m_mimeType, content.size());
+        qint64 smallest = content.size();
+
+        for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+        {
+            ContentEncoding encoding = static_cast<ContentEncoding>(i);
+            QFileInfo sidecarInfo(fileInfo.absoluteFilePath() % contentEncodingSuffix(encoding));
+            QByteArray encoded;
+
+            if (sidecarInfo.isFile() && sidecarInfo.lastModified() >= fileInfo.lastModified())
+            {
+                QFile sidecar(sidecarInfo.absoluteFilePath());
+
+                if (sidecar.open(QFile::ReadOnly))
+                {
+                    encoded = sidecar.readAll();
+                }
+            }
+            else if (worthCompressing && isContentEncodingSupported(encoding))
+            {
+                encoded = compressContent(content, encoding);
+            }
+
+            if (!encoded.isEmpty() && encoded.size() < content.size())
+            {
+                bundled.m_content[i] = encoded;
+                smallest = qMin<qint64>(smallest, encoded.size());
+            }
+        }
+
+        originalTotal += content.size();
+        packedTotal += smallest;
+        builder.addFile(bundled);
+    }
+
+    QString errorString;
+
+    if (!builder.save(parser.positionalArguments().at(1), errorString))
+    {
+        err << "can't write " << parser.positionalArguments().at(1) << ": " << errorString << endl;
+        return 1;
+    }
+
+    out << "packed " << builder.fileCount() << " files, " << originalTotal << " bytes, " << packedTotal << " in their smallest encoding" << endl;
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QStringBuilder>
+#include <climits>
+#include "Compression.h"
+#include "StaticFileServer.h"
+
+// Writes the .br, .zst and .gz sidecars that StaticFileServer serves instead of compressing at runtime.
+// Run it on the asset directory as part of a deployment, sidecars older than their file are ignored by the server.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("Precompress");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Precompresses the compressible files of an asset directory into .br, .zst and .gz sidecars.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "The asset directory, walked recursively.");
+    QCommandLineOption forceOption(QStringList() << "f" << "force", "Regenerate sidecars that are up to date.");
+    parser.addOption(forceOption);
+    parser.process(a);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    QDir root(parser.positionalArguments().first());
+
+    if (!root.exists())
+    {
+        err << "no such directory: " << root.path() << endl;
+        return 1;
+    }
+
+    for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+    {
+        if (!isContentEncodingSupported(static_cast<ContentEncoding>(i)))
+        {
+            err << "skipping " << contentEncodingName(static_cast<ContentEncoding>(i)) << ", not supported by this build" << endl;
+        }
+    }
+
+    bool force = parser.isSet(forceOption);
+    int failures = 0;
+    qint64 originalTotal = 0;
+    qint64 savedTotal = 0;
+
+    QDirIterator iter(root.absolutePath(), QDir::Files, QDirIterator::Subdirectories);
+
+    while (iter.hasNext())
+    {
+        QFileInfo fileInfo(iter.next());
+        QString mimeType = StaticFileServer::mimeTypeForSuffix(fileInfo.suffix());
+
+        // sidecars have no known mime type, so they are skipped here too
+        if (!isWorthCompressing(mimeType, static_cast<int>(qMin<qint64>(fileInfo.size(), INT_MAX))))
+        {
+            continue;
+        }
+
+        QFile file(fileInfo.absoluteFilePath());
+
+        if (!file.open(QFile::ReadOnly))
+        {
+            err << "can't read " << fileInfo.absoluteFilePath() << endl;
+            ++failures;
+            continue;
+        }
+
+        QByteArray content = file.readAll();
+        file.close();
+
+        for(int i = static_cast<int>(ContentEncoding::Identity) + 1; i < ContentEncodingCount; ++i)
+        {
+            ContentEncoding encoding = static_cast<ContentEncoding>(i);
+
+            if (!isContentEncodingSupported(encoding))
+            {
+                continue;
+            }
+
+            QString sidecarPath = fileInfo.absoluteFilePath() % contentEncodingSuffix(encoding);
+            QFileInfo sidecarInfo(sidecarPath);
+
+            if (!force && sidecarInfo.isFile() && sidecarInfo.lastModified() >= fileInfo.lastModified())
+            {
+                continue;
+            }
+
+            QByteArray encoded = compressContent(content, encoding);
+
+            if (encoded.isEmpty() || encoded.size() >= content.size())
+            {
+                // a stale sidecar would be ignored by the server anyway, don't leave it around
+                QFile::remove(sidecarPath);
+                continue;
+            }
+
+            QSaveFile sidecar(sidecarPath);
+
+            if (!sidecar.open(QIODevice::WriteOnly) || sidecar.write(encoded) != encoded.size() || !sidecar.commit())
+            {
+                err << "can't write " << sidecarPath << endl;
+                ++failures;
+                continue;
+            }
+
+            originalTotal += content.size();
+            savedTotal += content.size() - encoded.size();
+
+            out << sidecarPath << ": " << content.size() << " -> " << encoded.size() << " bytes" << endl;
+        }
+    }
+
+    out << "saved " << savedTotal << " of " << originalTotal << " bytes" << endl;
+
+    return failures ? 1 : 0;
+}